@@ -0,0 +1,47 @@
+#ifndef PINBALL_ARENA_H
+#define PINBALL_ARENA_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Memory for the whole session. An Arena is one block taken at startup and
+// handed out by bumping an offset; nothing is freed on its own, the block
+// goes back in one piece at exit. Balls and particles keep their storage
+// across a hot reload, so the arena is never rewound while playing. The
+// high-water mark lets the capacity be sized from real sessions.
+
+#define ARENA_ALIGNMENT 16
+
+typedef struct {
+    unsigned char *base;
+    size_t capacity;
+    size_t used;
+    size_t highWater;
+} Arena;
+
+static inline bool InitArena(Arena *arena, size_t capacity) {
+    memset(arena, 0, sizeof(*arena));
+    arena->base = (unsigned char *)malloc(capacity);
+    if (!arena->base) return false;
+    arena->capacity = capacity;
+    return true;
+}
+
+static inline void FreeArena(Arena *arena) {
+    free(arena->base);
+    memset(arena, 0, sizeof(*arena));
+}
+
+// Returns zeroed memory, or NULL once the arena is exhausted.
+static inline void *ArenaAlloc(Arena *arena, size_t size) {
+    size_t offset = (arena->used + ARENA_ALIGNMENT - 1) & ~(size_t)(ARENA_ALIGNMENT - 1);
+    if (offset > arena->capacity || size > arena->capacity - offset) return NULL;
+    arena->used = offset + size;
+    if (arena->used > arena->highWater) arena->highWater = arena->used;
+    memset(arena->base + offset, 0, size);
+    return arena->base + offset;
+}
+
+#endif
@@ -0,0 +1,165 @@
+#ifndef PINBALL_ATLAS_H
+#define PINBALL_ATLAS_H
+
+#include "raylib.h"
+#include "physics.h"
+#include "table.h"
+#include <math.h>
+#include <string.h>
+
+// All planet sprites are packed into one texture so the planet pass is a single
+// batched submission. Each distinct texture name gets one square tile sized to
+// the largest planet using it, with a transparent border against filter bleed.
+
+#define ATLAS_MAX_TILE 256
+#define ATLAS_TILE_PADDING 2
+
+typedef struct {
+    Texture2D texture;
+    Rectangle regions[MAX_PLANETS];
+    bool hasRegion[MAX_PLANETS];
+} SpriteAtlas;
+
+static inline int AtlasTileSize(float diameter) {
+    int size = 16;
+    while (size < ATLAS_MAX_TILE && size < (int)ceilf(diameter) + 2 * ATLAS_TILE_PADDING) size *= 2;
+    return size;
+}
+
+// Assigns each distinct texture name one tile owned by the first planet using
+// it. Returns the number of tiles; owner[i] is -1 for planets without a sprite.
+static inline int PlanAtlasTiles(const Table *table, const TableAssets *assets, int *owner, int *tileSize) {
+    int tileCount = 0;
+    *tileSize = 16;
+    for (int i = 0; i < table->planetCount; i++) {
+        owner[i] = -1;
+        if (assets->planetTextures[i][0] == '\0') continue;
+        for (int j = 0; j < i; j++) {
+            if (owner[j] == j && strcmp(assets->planetTextures[i], assets->planetTextures[j]) == 0) owner[i] = j;
+        }
+        if (owner[i] < 0) {
+            owner[i] = i;
+            tileCount++;
+        }
+        int size = AtlasTileSize(table->planets[i].radius * 2.0f);
+        if (size > *tileSize) *tileSize = size;
+    }
+    return tileCount;
+}
+
+// Decodes one sprite and scales it to the inside of a tile. Touches no GPU
+// state, so loader threads can run several of these at once. A missing or
+// broken file gets a magenta placeholder disc, so the gap is obvious on the
+// table instead of the planet silently turning into a plain circle.
+static inline Image LoadAtlasSprite(const char *path, int tileSize) {
+    int inner = tileSize - 2 * ATLAS_TILE_PADDING;
+    Image sprite = LoadImage(path);
+    if (sprite.data == NULL) {
+        TraceLog(LOG_WARNING, "ATLAS: %s missing, using a placeholder", path);
+        sprite = GenImageColor(inner, inner, BLANK);
+        ImageDrawCircle(&sprite, inner / 2, inner / 2, inner / 2, DARKGRAY);
+        ImageDrawCircle(&sprite, inner / 2, inner / 2, inner / 2 - inner / 8, MAGENTA);
+        return sprite;
+    }
+    ImageFormat(&sprite, PIXELFORMAT_UNCOMPRESSED_R8G8B8A8);
+    ImageResize(&sprite, inner, inner);
+    return sprite;
+}
+
+// Copies decoded sprites (indexed by owning planet) into tiles of one image and
+// fills in the atlas regions. The sprites stay owned by the caller.
+static inline Image PackAtlasSprites(const Table *table, const int *owner, const Image *sprites,
+                                     int tileCount, int tileSize, SpriteAtlas *atlas) {
+    memset(atlas->hasRegion, 0, sizeof(atlas->hasRegion));
+    if (tileCount == 0) return (Image){0};
+
+    int columns = (int)ceilf(sqrtf((float)tileCount));
+    int rows = (tileCount + columns - 1) / columns;
+    int inner = tileSize - 2 * ATLAS_TILE_PADDING;
+    Image atlasImage = GenImageColor(columns * tileSize, rows * tileSize, BLANK);
+
+    int tile = 0;
+    for (int i = 0; i < table->planetCount; i++) {
+        if (owner[i] != i || sprites[i].data == NULL) continue;
+
+        Rectangle region = {
+            (float)((tile % columns) * tileSize + ATLAS_TILE_PADDING),
+            (float)((tile / columns) * tileSize + ATLAS_TILE_PADDING),
+            (float)inner, (float)inner
+        };
+        ImageDraw(&atlasImage, sprites[i], (Rectangle){0, 0, (float)inner, (float)inner}, region, WHITE);
+
+        atlas->regions[i] = region;
+        atlas->hasRegion[i] = true;
+        tile++;
+    }
+
+    for (int i = 0; i < table->planetCount; i++) {
+        if (owner[i] >= 0 && owner[i] != i && atlas->hasRegion[owner[i]]) {
+            atlas->regions[i] = atlas->regions[owner[i]];
+            atlas->hasRegion[i] = true;
+        }
+    }
+    return atlasImage;
+}
+
+// CPU half of the atlas build: decodes and packs the sprites into one image.
+// Safe to run away from the render thread; the result is uploaded separately.
+static inline Image ComposePlanetAtlas(const Table *table, const TableAssets *assets, SpriteAtlas *atlas) {
+    Image sprites[MAX_PLANETS];
+    int owner[MAX_PLANETS];
+    int tileSize;
+    int tileCount = PlanAtlasTiles(table, assets, owner, &tileSize);
+
+    for (int i = 0; i < table->planetCount; i++) {
+        sprites[i] = owner[i] == i ? LoadAtlasSprite(assets->planetTextures[i], tileSize) : (Image){0};
+    }
+    Image atlasImage = PackAtlasSprites(table, owner, sprites, tileCount, tileSize, atlas);
+    for (int i = 0; i < table->planetCount; i++) {
+        if (sprites[i].data != NULL) UnloadImage(sprites[i]);
+    }
+    return atlasImage;
+}
+
+static inline void UploadSpriteAtlas(SpriteAtlas *atlas, Image atlasImage) {
+    atlas->texture = (Texture2D){0};
+    if (atlasImage.data == NULL) return;
+    atlas->texture = LoadTextureFromImage(atlasImage);
+    SetTextureFilter(atlas->texture, TEXTURE_FILTER_BILINEAR);
+}
+
+static inline void BuildPlanetAtlas(const Table *table, const TableAssets *assets, SpriteAtlas *atlas) {
+    Image atlasImage = ComposePlanetAtlas(table, assets, atlas);
+    UploadSpriteAtlas(atlas, atlasImage);
+    if (atlasImage.data != NULL) UnloadImage(atlasImage);
+}
+
+static inline void UnloadSpriteAtlas(SpriteAtlas *atlas) {
+    if (atlas->texture.id != 0) UnloadTexture(atlas->texture);
+    memset(atlas, 0, sizeof(*atlas));
+}
+
+// Textured planets all come from the atlas texture, so raylib keeps them in one
+// batch; planets without a sprite are drawn as plain circles afterwards.
+static inline void DrawPlanets(const Table *table, const SpriteAtlas *atlas) {
+    if (atlas->texture.id != 0) {
+        for (int i = 0; i < table->planetCount; i++) {
+            if (!atlas->hasRegion[i]) continue;
+            const Planet *planet = &table->planets[i];
+            Rectangle destRect = {
+                planet->x - planet->radius,
+                planet->y - planet->radius,
+                planet->radius * 2,
+                planet->radius * 2
+            };
+            DrawTexturePro(atlas->texture, atlas->regions[i], destRect, (Vector2){0, 0}, 0, WHITE);
+        }
+    }
+
+    for (int i = 0; i < table->planetCount; i++) {
+        if (atlas->texture.id != 0 && atlas->hasRegion[i]) continue;
+        DrawCircle((int)table->planets[i].x, (int)table->planets[i].y, table->planets[i].radius, DARKBLUE);
+    }
+}
+
+#endif
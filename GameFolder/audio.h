@@ -0,0 +1,179 @@
+#ifndef PINBALL_AUDIO_H
+#define PINBALL_AUDIO_H
+
+#include "raylib.h"
+#include "events.h"
+#include <stdatomic.h>
+#include <stdint.h>
+#include <string.h>
+
+// Collision mixer running in the raylib audio callback. Hits are read from the
+// event queue and started on a pool of voices playing one pre-decoded sample,
+// so overlapping hits layer instead of restarting a single Sound. Event times
+// are mapped onto the output sample clock through a short jitter buffer: hits
+// keep their spacing within a step exactly, at a fixed latency.
+
+#define MIXER_SAMPLE_RATE 48000
+#define MIXER_BUFFER_FRAMES 256
+#define MIXER_LATENCY_FRAMES 1024
+#define MIXER_MAX_VOICES 16
+#define MIXER_REFERENCE_IMPULSE 600.0f
+#define MIXER_MIN_IMPULSE 20.0f
+
+typedef struct {
+    bool active;
+    int64_t startFrame;
+    unsigned int position;
+    float gain;
+} MixerVoice;
+
+typedef struct {
+    AudioStream stream;
+    float *samples;
+    unsigned int sampleCount;
+    MixerVoice voices[MIXER_MAX_VOICES];
+    // Sample swap for hot reload: the main thread fills pending and raises
+    // swapPending; the callback takes it over and parks the old buffer in
+    // retired for the main thread to free.
+    float *pendingSamples;
+    unsigned int pendingCount;
+    float *retiredSamples;
+    atomic_bool swapPending;
+    CollisionEventQueue *queue;
+    int consumer;
+    double stepSeconds;
+    int64_t renderedFrames;
+    bool anchored;
+    int64_t anchorFrame;
+    double anchorTime;
+} AudioMixer;
+
+// raylib stream callbacks carry no user pointer.
+static AudioMixer *activeAudioMixer;
+
+static inline void ScheduleCollisionVoice(AudioMixer *mixer, const CollisionEvent *event) {
+    // Resting contacts report every step with almost no impulse; keep them silent.
+    if (event->impulse < MIXER_MIN_IMPULSE) return;
+
+    double time = ((double)event->step + event->substepTime) * mixer->stepSeconds;
+    int64_t startFrame = mixer->anchorFrame + (int64_t)((time - mixer->anchorTime) * MIXER_SAMPLE_RATE);
+
+    // Re-anchor on the first hit, when the simulation fell behind the output
+    // clock, or when it ran too far ahead of it (a reset or a long stall).
+    if (!mixer->anchored || startFrame < mixer->renderedFrames ||
+        startFrame > mixer->renderedFrames + 4 * MIXER_LATENCY_FRAMES) {
+        mixer->anchored = true;
+        mixer->anchorFrame = mixer->renderedFrames + MIXER_LATENCY_FRAMES;
+        mixer->anchorTime = time;
+        startFrame = mixer->anchorFrame;
+    }
+
+    float gain = event->impulse / MIXER_REFERENCE_IMPULSE;
+    if (gain < 0.1f) gain = 0.1f;
+    if (gain > 1.0f) gain = 1.0f;
+
+    // Steal the quietest voice when all of them are busy.
+    int voiceIndex = 0;
+    for (int i = 0; i < MIXER_MAX_VOICES; i++) {
+        if (!mixer->voices[i].active) {
+            voiceIndex = i;
+            break;
+        }
+        if (mixer->voices[i].gain < mixer->voices[voiceIndex].gain) voiceIndex = i;
+    }
+    mixer->voices[voiceIndex] = (MixerVoice){true, startFrame, 0, gain};
+}
+
+static void MixCollisionAudio(void *bufferData, unsigned int frames) {
+    float *output = (float *)bufferData;
+    memset(output, 0, frames * sizeof(float));
+    AudioMixer *mixer = activeAudioMixer;
+    if (mixer == NULL) return;
+
+    if (atomic_load_explicit(&mixer->swapPending, memory_order_acquire)) {
+        for (int i = 0; i < MIXER_MAX_VOICES; i++) mixer->voices[i].active = false;
+        mixer->retiredSamples = mixer->samples;
+        mixer->samples = mixer->pendingSamples;
+        mixer->sampleCount = mixer->pendingCount;
+        mixer->pendingSamples = NULL;
+        atomic_store_explicit(&mixer->swapPending, false, memory_order_release);
+    }
+
+    CollisionEvent event;
+    while (PopCollisionEvent(mixer->queue, mixer->consumer, &event)) ScheduleCollisionVoice(mixer, &event);
+
+    for (int i = 0; i < MIXER_MAX_VOICES; i++) {
+        MixerVoice *voice = &mixer->voices[i];
+        if (!voice->active) continue;
+
+        int64_t offset = voice->startFrame - mixer->renderedFrames;
+        if (offset >= (int64_t)frames) continue;
+        unsigned int frame = offset > 0 ? (unsigned int)offset : 0;
+        for (; frame < frames && voice->position < mixer->sampleCount; frame++) {
+            output[frame] += mixer->samples[voice->position++] * voice->gain;
+        }
+        if (voice->position >= mixer->sampleCount) voice->active = false;
+    }
+
+    for (unsigned int frame = 0; frame < frames; frame++) {
+        if (output[frame] > 1.0f) output[frame] = 1.0f;
+        if (output[frame] < -1.0f) output[frame] = -1.0f;
+    }
+    mixer->renderedFrames += frames;
+}
+
+// The wave must already be in mixer format (MIXER_SAMPLE_RATE, 32-bit, mono);
+// the loader converts it off the main thread. The mixer keeps its own copy.
+static inline void InitAudioMixer(AudioMixer *mixer, Wave wave, CollisionEventQueue *queue, float stepSeconds) {
+    memset(mixer, 0, sizeof(*mixer));
+    atomic_init(&mixer->swapPending, false);
+    mixer->queue = queue;
+    mixer->stepSeconds = stepSeconds;
+    if (wave.data == NULL || !IsAudioDeviceReady()) return;
+    mixer->consumer = AddCollisionEventConsumer(queue);
+    if (mixer->consumer < 0) return;
+
+    mixer->samples = LoadWaveSamples(wave);
+    mixer->sampleCount = wave.frameCount;
+
+    SetAudioStreamBufferSizeDefault(MIXER_BUFFER_FRAMES);
+    mixer->stream = LoadAudioStream(MIXER_SAMPLE_RATE, 32, 1);
+    activeAudioMixer = mixer;
+    SetAudioStreamCallback(mixer->stream, MixCollisionAudio);
+    PlayAudioStream(mixer->stream);
+}
+
+// Replaces the collision sample while the stream keeps playing; the wave is
+// in mixer format as for InitAudioMixer. A mixer that never started (no sound
+// at launch) is started here instead, so it must not be called while the
+// simulation is producing events. Returns false while an earlier swap is still
+// waiting for the callback; the caller tries again later.
+static inline bool ReplaceMixerSample(AudioMixer *mixer, Wave wave, CollisionEventQueue *queue, float stepSeconds) {
+    if (wave.data == NULL) return true;
+    if (mixer->samples == NULL) {
+        InitAudioMixer(mixer, wave, queue, stepSeconds);
+        return true;
+    }
+    if (atomic_load_explicit(&mixer->swapPending, memory_order_acquire)) return false;
+    if (mixer->retiredSamples != NULL) UnloadWaveSamples(mixer->retiredSamples);
+    mixer->retiredSamples = NULL;
+    mixer->pendingSamples = LoadWaveSamples(wave);
+    mixer->pendingCount = wave.frameCount;
+    atomic_store_explicit(&mixer->swapPending, true, memory_order_release);
+    return true;
+}
+
+static inline void UnloadAudioMixer(AudioMixer *mixer) {
+    if (mixer->samples == NULL) return;
+    StopAudioStream(mixer->stream);
+    UnloadAudioStream(mixer->stream);
+    activeAudioMixer = NULL;
+    UnloadWaveSamples(mixer->samples);
+    if (mixer->pendingSamples != NULL) UnloadWaveSamples(mixer->pendingSamples);
+    if (mixer->retiredSamples != NULL) UnloadWaveSamples(mixer->retiredSamples);
+    mixer->samples = NULL;
+    mixer->pendingSamples = NULL;
+    mixer->retiredSamples = NULL;
+}
+
+#endif
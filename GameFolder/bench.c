@@ -0,0 +1,459 @@
+#include "physics.h"
+#include "replay.h"
+#include "table.h"
+#include "timer.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Regression and performance check for the physics step. Every replay of a
+// corpus is played through the headless step and its final state compared
+// with the golden values stored in the corpus: the first ball within a
+// tolerance, ball count and score exactly, and the state checksum for a bit
+// exact match. Drop-test entries throw the ball onto the resting flippers
+// over a grid of spots and speeds and fail outright if any ball goes through.
+// Timings are the best of a few runs; built with -DPINBALL_PROFILE
+// they are split per phase. Both are compared with a baseline saved on the
+// reference machine.
+
+#define BENCH_MAX_LINES 256
+#define BENCH_LINE_LENGTH 512
+#define BENCH_MAX_ENTRIES 64
+#define BENCH_PATH_LENGTH 256
+#define BENCH_DEFAULT_REPEAT 3
+#define BENCH_DEFAULT_TOLERANCE 0.01f
+#define BENCH_DEFAULT_MAX_SLOWDOWN 10.0
+#define BENCH_DROP_POINTS 13
+#define BENCH_DROP_SPEEDS 12
+#define BENCH_DROP_SPEED_STEP 500.0f
+#define BENCH_DROP_HEIGHT 120.0f
+#define BENCH_DROP_SECONDS 0.5f
+
+#if defined(PINBALL_PROFILE)
+#define BENCH_BUILD_NAME "profiled"
+#else
+#define BENCH_BUILD_NAME "unprofiled"
+#endif
+
+// The phases of the step worth tracking, in baseline column order.
+static const int benchPhases[] = {PROFILE_INTEGRATION, PROFILE_BOUNDARY, PROFILE_FLIPPER_CONTACTS, PROFILE_PLANETS, PROFILE_RULES};
+static const char *const benchPhaseNames[] = {"integration", "boundary", "flipper", "planet", "rules"};
+#define BENCH_PHASE_COUNT ((int)(sizeof(benchPhases) / sizeof(benchPhases[0])))
+
+// Phase times only exist in profiled builds; the columns are left out otherwise.
+#if defined(PINBALL_PROFILE)
+#define BENCH_SHOWN_PHASES BENCH_PHASE_COUNT
+#else
+#define BENCH_SHOWN_PHASES 0
+#endif
+
+typedef struct {
+    double stepsPerSecond;
+    double phaseNanoseconds[BENCH_PHASE_COUNT];
+} BenchTiming;
+
+typedef struct {
+    int line;
+    char name[64];
+    char replayPath[BENCH_PATH_LENGTH];
+    char tablePath[BENCH_PATH_LENGTH];
+    bool hasGolden;
+    int ballCount;
+    int score;
+    Ball ball;
+    uint32_t checksum;
+
+    bool hasBaseline;
+    BenchTiming baseline;
+} BenchEntry;
+
+typedef struct {
+    char lines[BENCH_MAX_LINES][BENCH_LINE_LENGTH];
+    int lineCount;
+    BenchEntry entries[BENCH_MAX_ENTRIES];
+    int entryCount;
+} BenchCorpus;
+
+// Corpus lines are "name replay table [balls score x y vx vy checksum]"; the
+// table is "-" for the built-in one, and a replay of "drop:HZ" runs the
+// flipper drop test at that step rate instead (see RunDropGrid). Entries without golden values are only
+// timed until --update fills them in.
+static bool LoadBenchCorpus(const char *path, BenchCorpus *corpus) {
+    FILE *file = fopen(path, "r");
+    if (!file) return false;
+    corpus->lineCount = corpus->entryCount = 0;
+    while (corpus->lineCount < BENCH_MAX_LINES && fgets(corpus->lines[corpus->lineCount], BENCH_LINE_LENGTH, file)) {
+        char *line = corpus->lines[corpus->lineCount];
+        line[strcspn(line, "\r\n")] = '\0';
+        int lineIndex = corpus->lineCount++;
+
+        char first[2];
+        if (sscanf(line, " %1s", first) != 1 || first[0] == '#' || corpus->entryCount >= BENCH_MAX_ENTRIES) continue;
+        BenchEntry *entry = &corpus->entries[corpus->entryCount];
+        memset(entry, 0, sizeof(*entry));
+        entry->line = lineIndex;
+        if (sscanf(line, "%63s %255s %255s", entry->name, entry->replayPath, entry->tablePath) != 3) {
+            fprintf(stderr, "%s:%d: bad line\n", path, lineIndex + 1);
+            continue;
+        }
+        entry->hasGolden = sscanf(line, "%*s %*s %*s %d %d %f %f %f %f %x", &entry->ballCount, &entry->score,
+                                  &entry->ball.x, &entry->ball.y, &entry->ball.velocityX, &entry->ball.velocityY,
+                                  &entry->checksum) == 7;
+        corpus->entryCount++;
+    }
+    fclose(file);
+    return true;
+}
+
+// Rewrites the corpus with the golden values of the current build; comments
+// and the order of entries are kept.
+static bool SaveBenchCorpus(const char *path, const BenchCorpus *corpus) {
+    FILE *file = fopen(path, "w");
+    if (!file) return false;
+    int entry = 0;
+    for (int i = 0; i < corpus->lineCount; i++) {
+        if (entry < corpus->entryCount && corpus->entries[entry].line == i) {
+            const BenchEntry *e = &corpus->entries[entry++];
+            fprintf(file, "%s %s %s %d %d %.9g %.9g %.9g %.9g %08x\n", e->name, e->replayPath, e->tablePath,
+                    e->ballCount, e->score, e->ball.x, e->ball.y, e->ball.velocityX, e->ball.velocityY, e->checksum);
+        } else {
+            fprintf(file, "%s\n", corpus->lines[i]);
+        }
+    }
+    return fclose(file) == 0;
+}
+
+// Baselines are "name steps_per_sec ns_per_step..." after a "build" line
+// naming the configuration that produced them.
+static bool LoadBenchBaseline(const char *path, BenchCorpus *corpus) {
+    FILE *file = fopen(path, "r");
+    if (!file) return false;
+    char line[BENCH_LINE_LENGTH], name[64];
+    while (fgets(line, sizeof(line), file)) {
+        char kernel[32], physics[32], build[32];
+        if (sscanf(line, "build %31s %31s %31s", kernel, physics, build) == 3) {
+            if (strcmp(kernel, SIMD_KERNEL_NAME) != 0 || strcmp(physics, PHYSICS_PROFILE_NAME) != 0 ||
+                strcmp(build, BENCH_BUILD_NAME) != 0) {
+                printf("note: baseline is from a %s/%s/%s build, this is %s/%s/%s\n", kernel, physics, build,
+                       SIMD_KERNEL_NAME, PHYSICS_PROFILE_NAME, BENCH_BUILD_NAME);
+            }
+            continue;
+        }
+        BenchTiming timing = {0};
+        int offset = 0;
+        if (sscanf(line, "%63s %lf%n", name, &timing.stepsPerSecond, &offset) != 2 || name[0] == '#') continue;
+        for (int i = 0; i < BENCH_PHASE_COUNT; i++) {
+            int consumed = 0;
+            if (sscanf(line + offset, "%lf%n", &timing.phaseNanoseconds[i], &consumed) != 1) break;
+            offset += consumed;
+        }
+        for (int i = 0; i < corpus->entryCount; i++) {
+            if (strcmp(corpus->entries[i].name, name) != 0) continue;
+            corpus->entries[i].hasBaseline = true;
+            corpus->entries[i].baseline = timing;
+        }
+    }
+    fclose(file);
+    return true;
+}
+
+static bool SaveBenchBaseline(const char *path, const BenchCorpus *corpus, const BenchTiming *timings, const bool *ran) {
+    FILE *file = fopen(path, "w");
+    if (!file) return false;
+    fprintf(file, "# name steps_per_sec, then ns per step for");
+    for (int i = 0; i < BENCH_PHASE_COUNT; i++) fprintf(file, " %s", benchPhaseNames[i]);
+    fprintf(file, "\nbuild %s %s %s\n", SIMD_KERNEL_NAME, PHYSICS_PROFILE_NAME, BENCH_BUILD_NAME);
+    for (int i = 0; i < corpus->entryCount; i++) {
+        if (!ran[i]) continue;
+        fprintf(file, "%s %.0f", corpus->entries[i].name, timings[i].stepsPerSecond);
+        for (int phase = 0; phase < BENCH_PHASE_COUNT; phase++) fprintf(file, " %.2f", timings[i].phaseNanoseconds[phase]);
+        fprintf(file, "\n");
+    }
+    return fclose(file) == 0;
+}
+
+// The final state of an entry, as compared with its golden values.
+typedef struct {
+    int ballCount;
+    int score;
+    Ball ball;
+    uint32_t checksum;
+    uint64_t stepCount;
+} BenchResult;
+
+static void StartBenchTiming(void) {
+#if defined(PINBALL_PROFILE)
+    // Phases accumulate over the whole run; no frame is ever closed.
+    memset(&activeProfiler, 0, sizeof(activeProfiler));
+#endif
+}
+
+static void FinishBenchTiming(double seconds, uint64_t stepCount, BenchTiming *timing) {
+    if (seconds <= 0.0) seconds = 1e-9;
+    timing->stepsPerSecond = (double)stepCount / seconds;
+    for (int phase = 0; phase < BENCH_PHASE_COUNT; phase++) {
+#if defined(PINBALL_PROFILE)
+        timing->phaseNanoseconds[phase] = activeProfiler.phaseSeconds[benchPhases[phase]] * 1e9 / (double)stepCount;
+#else
+        timing->phaseNanoseconds[phase] = 0.0;
+#endif
+    }
+}
+
+static void FillBenchResult(const GameState *state, uint64_t stepCount, BenchResult *result) {
+    result->ballCount = state->balls.count;
+    result->score = state->score;
+    result->ball = GetBall(&state->balls, 0);
+    result->checksum = GameStateChecksum(state);
+    result->stepCount = stepCount;
+}
+
+// Drop test: the ball falls onto every resting flipper at BENCH_DROP_POINTS
+// spots along the body, at speeds from one to twelve BENCH_DROP_SPEED_STEPs,
+// and each drop runs for BENCH_DROP_SECONDS without input. A drop is lost if
+// the ball's centre ever crosses a flipper's core segment in one step. The
+// result counts lost drops in place of the ball count, sums the scores and
+// folds the final checksums of all drops together.
+static void RunDropGrid(const Table *table, GameState *state, BenchResult *result) {
+    int steps = (int)(BENCH_DROP_SECONDS / table->physics.fixedDeltaTime);
+    int lost = 0, score = 0;
+    uint32_t checksum = 2166136261u;
+    uint64_t stepCount = 0;
+    for (int flipperIndex = 0; flipperIndex < table->flipperCount; flipperIndex++) {
+        for (int point = 0; point < BENCH_DROP_POINTS; point++) {
+            for (int speed = 1; speed <= BENCH_DROP_SPEEDS; speed++) {
+                ResetGameState(table, state);
+                const Flipper *flipper = &state->flippers[flipperIndex];
+                const FlipperPose *pose = &state->flipperPoses[flipperIndex];
+                float along = (float)(point + 1) / (float)(BENCH_DROP_POINTS + 1);
+                float x = flipper->pivotPoint.x + (pose->tip.x - flipper->pivotPoint.x) * along;
+                float y = flipper->pivotPoint.y + (pose->tip.y - flipper->pivotPoint.y) * along - BENCH_DROP_HEIGHT;
+                SetBall(&state->balls, 0, (Ball){x, y, table->ballRadius, 0.0f, (float)speed * BENCH_DROP_SPEED_STEP});
+
+                bool through = false;
+                for (int step = 0; step < steps; step++) {
+                    Vec2f before = {state->balls.x[0], state->balls.y[0]};
+                    int events = StepPhysics(table, state, 0);
+                    Vec2f after = {state->balls.x[0], state->balls.y[0]};
+                    if (events & STEP_EVENT_DRAIN) continue;
+                    for (int i = 0; i < table->flipperCount && !through; i++) {
+                        Vec2f pivot = state->flippers[i].pivotPoint, tip = state->flipperPoses[i].tip;
+                        through = (SegmentSide(pivot, tip, before) > 0.0f) != (SegmentSide(pivot, tip, after) > 0.0f) &&
+                                  (SegmentSide(before, after, pivot) > 0.0f) != (SegmentSide(before, after, tip) > 0.0f);
+                    }
+                }
+                lost += through ? 1 : 0;
+                score += state->score;
+                uint32_t dropChecksum = GameStateChecksum(state);
+                checksum = HashBytes(checksum, &dropChecksum, sizeof(dropChecksum));
+                stepCount += (uint64_t)steps;
+            }
+        }
+    }
+    FillBenchResult(state, stepCount, result);
+    result->ballCount = lost;
+    result->score = score;
+    result->checksum = checksum;
+}
+
+// Plays one entry `repeat` times and keeps the fastest run; the step is
+// deterministic, so every run ends in the same state. An entry this build
+// cannot play, such as a 120 Hz one under PINBALL_PHYSICS_FIXED, is skipped.
+static bool RunBenchEntry(const BenchEntry *entry, int repeat, BenchResult *result, BenchTiming *timing,
+                          bool *skipped, char *error, size_t errorSize) {
+    static Table table;
+    static GameState state;
+    *skipped = false;
+    if (strcmp(entry->tablePath, "-") == 0) {
+        InitDefaultTable(&table);
+    } else {
+        TableFile tableFile;
+        if (!OpenTable(entry->tablePath, &tableFile, error, errorSize)) return false;
+        table = *tableFile.table;
+        CloseTableFile(&tableFile);
+    }
+
+    bool dropTest = strncmp(entry->replayPath, "drop:", 5) == 0;
+    Replay replay;
+    if (dropTest) {
+        float stepRate = (float)atof(entry->replayPath + 5);
+        if (stepRate <= 0.0f) {
+            snprintf(error, errorSize, "bad drop test rate %s", entry->replayPath + 5);
+            return false;
+        }
+        table.physics.fixedDeltaTime = 1.0f / stepRate;
+        table.multiballJackpotScore = 0;
+    } else {
+        if (!LoadReplay(entry->replayPath, &replay, error, errorSize)) return false;
+        ApplyReplaySettings(&replay, &table);
+    }
+    if (!PhysicsMatchesProfile(&table.physics)) {
+        snprintf(error, errorSize, "skipped, step settings differ from this build's fixed profile");
+        *skipped = true;
+        if (!dropTest) FreeReplay(&replay);
+        return false;
+    }
+    if (!InitGameState(&table, &state, 1 + MULTIBALL_EXTRA_BALLS)) {
+        snprintf(error, errorSize, "out of memory");
+        if (!dropTest) FreeReplay(&replay);
+        return false;
+    }
+
+    double bestSeconds = 0.0;
+    bool ok = true;
+    for (int run = 0; run < repeat && ok; run++) {
+        BenchResult runResult;
+        double startTime;
+        if (dropTest) {
+            StartBenchTiming();
+            startTime = TimerNowSeconds();
+            RunDropGrid(&table, &state, &runResult);
+        } else {
+            ReplayCursor cursor;
+            if (!StartReplayPlayback(&replay, &table, &state, &cursor, error, errorSize)) {
+                ok = false;
+                break;
+            }
+            StartBenchTiming();
+            startTime = TimerNowSeconds();
+            unsigned int inputMask;
+            while (NextReplayInput(&replay, &cursor, &inputMask)) StepPhysics(&table, &state, inputMask);
+            FillBenchResult(&state, replay.header.stepCount, &runResult);
+        }
+        double seconds = TimerNowSeconds() - startTime;
+        if (run > 0 && seconds >= bestSeconds) continue;
+        bestSeconds = seconds;
+        *result = runResult;
+        FinishBenchTiming(seconds, runResult.stepCount, timing);
+    }
+    FreeGameState(&state);
+    if (!dropTest) FreeReplay(&replay);
+    return ok;
+}
+
+// "exact" when the checksum matches too, "ok" within tolerance, "FAIL"
+// otherwise. A drop test that loses a ball always fails.
+static const char *CheckBenchEntry(const BenchEntry *entry, const BenchResult *result, float tolerance, bool *passed) {
+    *passed = strncmp(entry->replayPath, "drop:", 5) != 0 || result->ballCount == 0;
+    if (!entry->hasGolden) return *passed ? "new" : "FAIL";
+    const Ball *ball = &result->ball;
+    *passed = *passed && result->ballCount == entry->ballCount && result->score == entry->score &&
+              fabsf(ball->x - entry->ball.x) <= tolerance && fabsf(ball->y - entry->ball.y) <= tolerance &&
+              fabsf(ball->velocityX - entry->ball.velocityX) <= tolerance &&
+              fabsf(ball->velocityY - entry->ball.velocityY) <= tolerance;
+    if (!*passed) return "FAIL";
+    return result->checksum == entry->checksum ? "exact" : "ok";
+}
+
+static double PercentChange(double now, double before) {
+    return before > 0.0 ? (now - before) * 100.0 / before : 0.0;
+}
+
+int main(int argc, char **argv) {
+    const char *corpusPath = "bench/corpus.txt";
+    const char *baselinePath = "bench/baseline.txt";
+    const char *saveBaselinePath = NULL;
+    int repeat = BENCH_DEFAULT_REPEAT;
+    float tolerance = BENCH_DEFAULT_TOLERANCE;
+    double maxSlowdown = BENCH_DEFAULT_MAX_SLOWDOWN;
+    bool update = false;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--corpus") == 0 && i + 1 < argc) corpusPath = argv[++i];
+        else if (strcmp(argv[i], "--baseline") == 0 && i + 1 < argc) baselinePath = argv[++i];
+        else if (strcmp(argv[i], "--save-baseline") == 0 && i + 1 < argc) saveBaselinePath = argv[++i];
+        else if (strcmp(argv[i], "--repeat") == 0 && i + 1 < argc) repeat = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--tolerance") == 0 && i + 1 < argc) tolerance = (float)atof(argv[++i]);
+        else if (strcmp(argv[i], "--max-slowdown") == 0 && i + 1 < argc) maxSlowdown = atof(argv[++i]);
+        else if (strcmp(argv[i], "--update") == 0) update = true;
+        else {
+            fprintf(stderr, "usage: %s [--corpus FILE] [--baseline FILE] [--save-baseline FILE] [--repeat N]\n"
+                            "       [--tolerance UNITS] [--max-slowdown PERCENT] [--update]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (repeat < 1) repeat = 1;
+
+    static BenchCorpus corpus;
+    if (!LoadBenchCorpus(corpusPath, &corpus)) {
+        fprintf(stderr, "cannot read %s\n", corpusPath);
+        return 1;
+    }
+    bool haveBaseline = LoadBenchBaseline(baselinePath, &corpus);
+    printf("kernel %s, %s physics, %s build, best of %d, tolerance %g\n", SIMD_KERNEL_NAME, PHYSICS_PROFILE_NAME,
+           BENCH_BUILD_NAME, repeat, tolerance);
+    if (!haveBaseline) printf("no baseline at %s, timings are not compared\n", baselinePath);
+
+    printf("%-14s %8s %-6s %10s", "replay", "steps", "result", "steps/s");
+    for (int phase = 0; phase < BENCH_SHOWN_PHASES; phase++) printf(" %11s", benchPhaseNames[phase]);
+    printf(BENCH_SHOWN_PHASES > 0 ? "   (ns/step)\n" : "\n");
+
+    static BenchTiming timings[BENCH_MAX_ENTRIES];
+    static bool ran[BENCH_MAX_ENTRIES];
+    int failures = 0, regressions = 0, skips = 0;
+    for (int i = 0; i < corpus.entryCount; i++) {
+        BenchEntry *entry = &corpus.entries[i];
+        BenchResult result;
+        bool skipped;
+        char error[BENCH_LINE_LENGTH];
+        if (!RunBenchEntry(entry, repeat, &result, &timings[i], &skipped, error, sizeof(error))) {
+            printf("%-14s %s\n", entry->name, error);
+            if (skipped) skips++;
+            else failures++;
+            continue;
+        }
+        ran[i] = true;
+
+        bool passed;
+        const char *verdict = CheckBenchEntry(entry, &result, tolerance, &passed);
+        if (!passed && !update) failures++;
+        printf("%-14s %8llu %-6s %10.0f", entry->name, (unsigned long long)result.stepCount, verdict, timings[i].stepsPerSecond);
+        for (int phase = 0; phase < BENCH_SHOWN_PHASES; phase++) printf(" %11.1f", timings[i].phaseNanoseconds[phase]);
+        printf("\n");
+        if (!passed) {
+            const Ball *ball = &result.ball;
+            printf("%14s got %d balls, score %d, ball %.3f %.3f %.3f %.3f; want %d, %d, %.3f %.3f %.3f %.3f\n", "",
+                   result.ballCount, result.score, ball->x, ball->y, ball->velocityX, ball->velocityY, entry->ballCount,
+                   entry->score, entry->ball.x, entry->ball.y, entry->ball.velocityX, entry->ball.velocityY);
+        }
+
+        // Relative to the baseline: speed up positive, phase time down negative.
+        if (entry->hasBaseline) {
+            double speed = PercentChange(timings[i].stepsPerSecond, entry->baseline.stepsPerSecond);
+            bool slower = -speed > maxSlowdown;
+            if (slower) regressions++;
+            printf("%-14s %8s %-6s %+9.1f%%", "", "", slower ? "SLOWER" : "", speed);
+            for (int phase = 0; phase < BENCH_SHOWN_PHASES; phase++) {
+                printf(" %+10.1f%%", PercentChange(timings[i].phaseNanoseconds[phase], entry->baseline.phaseNanoseconds[phase]));
+            }
+            printf("\n");
+        }
+
+        if (update) {
+            entry->hasGolden = true;
+            entry->ballCount = result.ballCount;
+            entry->score = result.score;
+            entry->ball = result.ball;
+            entry->checksum = result.checksum;
+        }
+    }
+
+    if (update) {
+        if (!SaveBenchCorpus(corpusPath, &corpus)) {
+            fprintf(stderr, "cannot write %s\n", corpusPath);
+            return 1;
+        }
+        printf("golden values written to %s\n", corpusPath);
+    }
+    if (saveBaselinePath) {
+        if (!SaveBenchBaseline(saveBaselinePath, &corpus, timings, ran)) {
+            fprintf(stderr, "cannot write %s\n", saveBaselinePath);
+            return 1;
+        }
+        printf("baseline written to %s\n", saveBaselinePath);
+    }
+
+    printf("%d of %d replays failed, %d skipped, %d slower than baseline by more than %.0f%%\n", failures,
+           corpus.entryCount, skips, regressions, maxSlowdown);
+    if (failures > 0) return 1;
+    return regressions > 0 ? 2 : 0;
+}
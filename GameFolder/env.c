@@ -0,0 +1,208 @@
+#define PINBALL_ENV_BUILD
+#include "env.h"
+#include "physics.h"
+#include "pool.h"
+#include "table.h"
+#include <stdlib.h>
+#include <string.h>
+
+// Build as a shared library, e.g.
+//   gcc -O2 -shared -fPIC -pthread -o libpinballenv.so env.c -lm
+
+#define ENV_BALL_CAPACITY (1 + MULTIBALL_EXTRA_BALLS)
+#define ENV_PER_TASK 32
+
+struct PinballEnv {
+    Table table;
+    int envCount;
+    int observationSize;
+    int64_t maxEpisodeSteps;
+    GameState *states;
+    float *ballStorage;
+    uint32_t *seeds;
+    float *observations;
+    float *rewards;
+    uint8_t *dones;
+    int32_t *scores;
+    const uint8_t *actions;
+    int frameSkip;
+    TaskPool pool;
+};
+
+static void WriteObservation(PinballEnv *env, int envIndex) {
+    const GameState *state = &env->states[envIndex];
+    float *observation = env->observations + (size_t)envIndex * env->observationSize;
+
+    for (int i = 0; i < ENV_BALL_CAPACITY; i++) {
+        float *slot = observation + i * PINBALL_ENV_BALL_FIELDS;
+        bool present = i < state->balls.count;
+        slot[0] = present ? state->balls.x[i] : 0.0f;
+        slot[1] = present ? state->balls.y[i] : 0.0f;
+        slot[2] = present ? state->balls.velocityX[i] : 0.0f;
+        slot[3] = present ? state->balls.velocityY[i] : 0.0f;
+        slot[4] = present ? 1.0f : 0.0f;
+    }
+    observation += ENV_BALL_CAPACITY * PINBALL_ENV_BALL_FIELDS;
+    for (int i = 0; i < env->table.flipperCount; i++) {
+        observation[i * PINBALL_ENV_FLIPPER_FIELDS] = state->flippers[i].currentAngle;
+        observation[i * PINBALL_ENV_FLIPPER_FIELDS + 1] = state->flipperActive[i] ? 1.0f : 0.0f;
+    }
+    env->scores[envIndex] = state->score;
+}
+
+// Each reset moves the seed on, so successive episodes start differently.
+static void ResetEnvironment(PinballEnv *env, int envIndex) {
+    GameState *state = &env->states[envIndex];
+    uint32_t *seed = &env->seeds[envIndex];
+    ResetGameState(&env->table, state);
+    *seed = *seed * 1664525u + 1013904223u;
+    state->balls.x[0] += ((float)(*seed >> 8) / 16777216.0f - 0.5f) * 40.0f;
+    *seed = *seed * 1664525u + 1013904223u;
+    state->balls.velocityX[0] = ((float)(*seed >> 8) / 16777216.0f - 0.5f) * 200.0f;
+    SaveBallPositions(&state->balls);
+}
+
+static void StepEnvironmentTask(void *context, int taskIndex, int workerIndex) {
+    PinballEnv *env = (PinballEnv *)context;
+    (void)workerIndex;
+    int first = taskIndex * ENV_PER_TASK;
+    int last = first + ENV_PER_TASK < env->envCount ? first + ENV_PER_TASK : env->envCount;
+
+    for (int envIndex = first; envIndex < last; envIndex++) {
+        GameState *state = &env->states[envIndex];
+        unsigned int inputMask = env->actions ? env->actions[envIndex] : 0u;
+        int startScore = state->score;
+        bool done = false;
+
+        for (int step = 0; step < env->frameSkip && !done; step++) {
+            bool lastBall = state->balls.count == 1;
+            int scoreBefore = state->score;
+            int events = StepPhysics(&env->table, state, inputMask);
+            if ((events & STEP_EVENT_DRAIN) && lastBall) {
+                // The step already reset the score of the drained ball.
+                env->rewards[envIndex] = (float)(scoreBefore - startScore);
+                env->scores[envIndex] = scoreBefore;
+                done = true;
+            } else if (env->maxEpisodeSteps > 0 && (int64_t)state->stepCount >= env->maxEpisodeSteps) {
+                env->rewards[envIndex] = (float)(state->score - startScore);
+                env->scores[envIndex] = state->score;
+                done = true;
+            }
+        }
+
+        env->dones[envIndex] = done ? 1 : 0;
+        if (done) {
+            ResetEnvironment(env, envIndex);
+            int finalScore = env->scores[envIndex];
+            WriteObservation(env, envIndex);
+            env->scores[envIndex] = finalScore;
+        } else {
+            env->rewards[envIndex] = (float)(state->score - startScore);
+            WriteObservation(env, envIndex);
+        }
+    }
+}
+
+PinballEnv *PinballEnvCreate(int envCount, int threadCount, const char *tablePath, uint32_t seed, int64_t maxEpisodeSteps) {
+    if (envCount <= 0) return NULL;
+    PinballEnv *env = (PinballEnv *)calloc(1, sizeof(PinballEnv));
+    if (!env) return NULL;
+
+    if (tablePath) {
+        TableFile tableFile;
+        char error[256];
+        if (!OpenTable(tablePath, &tableFile, error, sizeof(error))) {
+            free(env);
+            return NULL;
+        }
+        env->table = *tableFile.table;
+        CloseTableFile(&tableFile);
+    } else {
+        InitDefaultTable(&env->table);
+    }
+
+    env->envCount = envCount;
+    env->observationSize = ENV_BALL_CAPACITY * PINBALL_ENV_BALL_FIELDS + env->table.flipperCount * PINBALL_ENV_FLIPPER_FIELDS;
+    env->maxEpisodeSteps = maxEpisodeSteps;
+
+    // Game states and the ball arrays of every environment each sit in one block.
+    env->states = (GameState *)calloc((size_t)envCount, sizeof(GameState));
+    env->ballStorage = (float *)calloc((size_t)envCount * ENV_BALL_CAPACITY * BALL_BATCH_FIELDS, sizeof(float));
+    env->seeds = (uint32_t *)malloc((size_t)envCount * sizeof(uint32_t));
+    env->observations = (float *)calloc((size_t)envCount * env->observationSize, sizeof(float));
+    env->rewards = (float *)calloc((size_t)envCount, sizeof(float));
+    env->dones = (uint8_t *)calloc((size_t)envCount, 1);
+    env->scores = (int32_t *)calloc((size_t)envCount, sizeof(int32_t));
+    if (!env->states || !env->ballStorage || !env->seeds || !env->observations || !env->rewards || !env->dones || !env->scores) {
+        PinballEnvDestroy(env);
+        return NULL;
+    }
+
+    for (int i = 0; i < envCount; i++) {
+        AttachBallBatch(&env->states[i].balls, env->ballStorage + (size_t)i * ENV_BALL_CAPACITY * BALL_BATCH_FIELDS,
+                        ENV_BALL_CAPACITY);
+        env->seeds[i] = seed ^ (2654435761u * (uint32_t)(i + 1));
+    }
+    InitTaskPool(&env->pool, threadCount);
+    PinballEnvReset(env, -1);
+    return env;
+}
+
+void PinballEnvDestroy(PinballEnv *env) {
+    if (!env) return;
+    if (env->pool.workerCount > 0) DestroyTaskPool(&env->pool);
+    free(env->states);
+    free(env->ballStorage);
+    free(env->seeds);
+    free(env->observations);
+    free(env->rewards);
+    free(env->dones);
+    free(env->scores);
+    free(env);
+}
+
+int PinballEnvCount(const PinballEnv *env) {
+    return env->envCount;
+}
+
+int PinballEnvObservationSize(const PinballEnv *env) {
+    return env->observationSize;
+}
+
+float PinballEnvStepSeconds(const PinballEnv *env) {
+    return env->table.physics.fixedDeltaTime;
+}
+
+float *PinballEnvObservations(PinballEnv *env) {
+    return env->observations;
+}
+
+float *PinballEnvRewards(PinballEnv *env) {
+    return env->rewards;
+}
+
+uint8_t *PinballEnvDones(PinballEnv *env) {
+    return env->dones;
+}
+
+int32_t *PinballEnvScores(PinballEnv *env) {
+    return env->scores;
+}
+
+void PinballEnvReset(PinballEnv *env, int envIndex) {
+    int first = envIndex < 0 ? 0 : envIndex;
+    int last = envIndex < 0 ? env->envCount : envIndex + 1;
+    for (int i = first; i < last && i < env->envCount; i++) {
+        ResetEnvironment(env, i);
+        env->rewards[i] = 0.0f;
+        env->dones[i] = 0;
+        WriteObservation(env, i);
+    }
+}
+
+void PinballEnvStep(PinballEnv *env, const uint8_t *actions, int frameSkip) {
+    env->actions = actions;
+    env->frameSkip = frameSkip > 0 ? frameSkip : 1;
+    RunTaskPool(&env->pool, (env->envCount + ENV_PER_TASK - 1) / ENV_PER_TASK, StepEnvironmentTask, env);
+    env->actions = NULL;
+}
@@ -0,0 +1,65 @@
+#ifndef PINBALL_ENV_H
+#define PINBALL_ENV_H
+
+#include <stdint.h>
+
+// Vectorized training environment around the physics step, for use from other
+// languages through a shared library (see env.c for the build line). N tables
+// are stepped in lockstep across a thread pool. Observations, rewards, done
+// flags and scores live in buffers owned by the environment that are
+// rewritten in place by every reset and step, so a binding can wrap the
+// pointers once and read them without copying.
+//
+// Observation layout per environment (floats, table units):
+//   ball slots x PINBALL_ENV_BALL_FIELDS: x, y, velocityX, velocityY, present
+//   flipper slots x PINBALL_ENV_FLIPPER_FIELDS: angle, actuated
+// Actions are flipper input masks: bit 0 left flippers, bit 1 right flippers.
+
+#if defined(_WIN32) && defined(PINBALL_ENV_BUILD)
+#define PINBALL_ENV_API __declspec(dllexport)
+#elif defined(_WIN32)
+#define PINBALL_ENV_API __declspec(dllimport)
+#else
+#define PINBALL_ENV_API __attribute__((visibility("default")))
+#endif
+
+#define PINBALL_ENV_BALL_FIELDS 5
+#define PINBALL_ENV_FLIPPER_FIELDS 2
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct PinballEnv PinballEnv;
+
+// tablePath may be NULL for the built-in table. threadCount <= 0 uses every
+// hardware thread. maxEpisodeSteps <= 0 lets episodes run until the last ball
+// drains. Returns NULL on failure.
+PINBALL_ENV_API PinballEnv *PinballEnvCreate(int envCount, int threadCount, const char *tablePath,
+                                             uint32_t seed, int64_t maxEpisodeSteps);
+PINBALL_ENV_API void PinballEnvDestroy(PinballEnv *env);
+
+PINBALL_ENV_API int PinballEnvCount(const PinballEnv *env);
+PINBALL_ENV_API int PinballEnvObservationSize(const PinballEnv *env);
+PINBALL_ENV_API float PinballEnvStepSeconds(const PinballEnv *env);
+
+// envCount x PinballEnvObservationSize floats, row per environment.
+PINBALL_ENV_API float *PinballEnvObservations(PinballEnv *env);
+// Score gained during the last PinballEnvStep, per environment.
+PINBALL_ENV_API float *PinballEnvRewards(PinballEnv *env);
+// 1 when the episode ended during the last step; that environment has already
+// been reset and its observation is the first of the next episode.
+PINBALL_ENV_API uint8_t *PinballEnvDones(PinballEnv *env);
+// Score of the running episode, or the final score when done is set.
+PINBALL_ENV_API int32_t *PinballEnvScores(PinballEnv *env);
+
+// Resets one environment, or all of them when envIndex is negative.
+PINBALL_ENV_API void PinballEnvReset(PinballEnv *env, int envIndex);
+// Applies actions[i] to environment i for frameSkip physics steps.
+PINBALL_ENV_API void PinballEnvStep(PinballEnv *env, const uint8_t *actions, int frameSkip);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
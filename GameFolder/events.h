@@ -0,0 +1,72 @@
+#ifndef PINBALL_EVENTS_H
+#define PINBALL_EVENTS_H
+
+#include "physics.h"
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+// Lock-free ring carrying collision events from the physics step to consumers
+// on other threads. There is one producer; each consumer has its own read
+// cursor, so several stages can see every event. The producer never waits: a
+// full ring drops the new event instead. dropped and peakFill are only
+// written by the producer and are meant to be read once it has stopped.
+
+#define EVENT_QUEUE_CAPACITY 1024
+#define EVENT_QUEUE_MAX_CONSUMERS 4
+
+typedef struct {
+    CollisionEvent events[EVENT_QUEUE_CAPACITY];
+    atomic_uint writeIndex;
+    atomic_uint readIndex[EVENT_QUEUE_MAX_CONSUMERS];
+    int consumerCount;
+    unsigned int dropped;
+    unsigned int peakFill;
+} CollisionEventQueue;
+
+static inline void InitCollisionEventQueue(CollisionEventQueue *queue) {
+    atomic_init(&queue->writeIndex, 0);
+    for (int i = 0; i < EVENT_QUEUE_MAX_CONSUMERS; i++) atomic_init(&queue->readIndex[i], 0);
+    queue->consumerCount = 0;
+    queue->dropped = 0;
+    queue->peakFill = 0;
+}
+
+// Consumers are registered before the producer starts; a consumer only sees
+// events pushed after it was added. Returns -1 when all cursors are taken.
+static inline int AddCollisionEventConsumer(CollisionEventQueue *queue) {
+    if (queue->consumerCount >= EVENT_QUEUE_MAX_CONSUMERS) return -1;
+    int consumer = queue->consumerCount++;
+    atomic_store(&queue->readIndex[consumer], atomic_load(&queue->writeIndex));
+    return consumer;
+}
+
+static inline bool PushCollisionEvent(CollisionEventQueue *queue, const CollisionEvent *event) {
+    unsigned int writeIndex = atomic_load_explicit(&queue->writeIndex, memory_order_relaxed);
+    for (int i = 0; i < queue->consumerCount; i++) {
+        unsigned int readIndex = atomic_load_explicit(&queue->readIndex[i], memory_order_acquire);
+        unsigned int fill = writeIndex - readIndex;
+        if (fill >= EVENT_QUEUE_CAPACITY) {
+            queue->dropped++;
+            return false;
+        }
+        if (fill + 1 > queue->peakFill) queue->peakFill = fill + 1;
+    }
+    queue->events[writeIndex % EVENT_QUEUE_CAPACITY] = *event;
+    atomic_store_explicit(&queue->writeIndex, writeIndex + 1, memory_order_release);
+    return true;
+}
+
+static inline void PublishStepEvents(CollisionEventQueue *queue, const GameState *state) {
+    for (int i = 0; i < state->stepEventCount; i++) PushCollisionEvent(queue, &state->stepEvents[i]);
+}
+
+static inline bool PopCollisionEvent(CollisionEventQueue *queue, int consumer, CollisionEvent *event) {
+    unsigned int readIndex = atomic_load_explicit(&queue->readIndex[consumer], memory_order_relaxed);
+    if (readIndex == atomic_load_explicit(&queue->writeIndex, memory_order_acquire)) return false;
+    *event = queue->events[readIndex % EVENT_QUEUE_CAPACITY];
+    atomic_store_explicit(&queue->readIndex[consumer], readIndex + 1, memory_order_release);
+    return true;
+}
+
+#endif
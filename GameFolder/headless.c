@@ -0,0 +1,167 @@
+#include "physics.h"
+#include "policy.h"
+#include "replay.h"
+#include "table.h"
+#include "timer.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static void SpawnBatch(const Table *table, GameState *state, int ballCount) {
+    uint32_t seed = 12345u;
+    while (state->balls.count < ballCount) {
+        seed = seed * 1664525u + 1013904223u;
+        float x = table->ballRadius + (float)(seed >> 8) / 16777216.0f * (table->width - 2.0f * table->ballRadius);
+        seed = seed * 1664525u + 1013904223u;
+        float velocityX = ((float)(seed >> 8) / 16777216.0f - 0.5f) * 400.0f;
+        AddBall(&state->balls, (Ball){x, table->ballRadius, table->ballRadius, velocityX, 0.0f});
+    }
+}
+
+int main(int argc, char **argv) {
+    long long stepCount = 5000000;
+    int ballCount = 1;
+    bool multiball = true;
+    bool noContinuousCollision = false;
+    float stepRate = 0.0f;
+    const char *tablePath = NULL;
+    const char *recordPath = NULL;
+    const char *replayPath = NULL;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--balls") == 0 && i + 1 < argc) ballCount = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--no-multiball") == 0) multiball = false;
+        else if (strcmp(argv[i], "--no-ccd") == 0) noContinuousCollision = true;
+        else if (strcmp(argv[i], "--rate") == 0 && i + 1 < argc) stepRate = (float)atof(argv[++i]);
+        else if (strcmp(argv[i], "--table") == 0 && i + 1 < argc) tablePath = argv[++i];
+        else if (strcmp(argv[i], "--record") == 0 && i + 1 < argc) recordPath = argv[++i];
+        else if (strcmp(argv[i], "--replay") == 0 && i + 1 < argc) replayPath = argv[++i];
+        else stepCount = strtoll(argv[i], NULL, 10);
+    }
+    if (stepCount <= 0 || ballCount <= 0 || ((recordPath || replayPath) && ballCount > 1)) {
+        fprintf(stderr, "usage: %s [steps] [--balls N] [--no-multiball] [--rate HZ] [--no-ccd] [--table FILE]\n"
+                        "       [--record FILE | --replay FILE] (single ball only)\n", argv[0]);
+        return 1;
+    }
+
+    static Table table;
+    GameState state;
+    if (tablePath) {
+        TableFile tableFile;
+        char error[256];
+        double loadStart = TimerNowSeconds();
+        if (!OpenTable(tablePath, &tableFile, error, sizeof(error))) {
+            fprintf(stderr, "%s\n", error);
+            return 1;
+        }
+        printf("table:          %s (%.3f ms)\n", tablePath, (TimerNowSeconds() - loadStart) * 1e3);
+        table = *tableFile.table;
+        CloseTableFile(&tableFile);
+    } else {
+        InitDefaultTable(&table);
+    }
+    if (!multiball || ballCount > 1) table.multiballJackpotScore = 0;
+    if (stepRate > 0.0f) table.physics.fixedDeltaTime = 1.0f / stepRate;
+    if (noContinuousCollision) table.physics.continuousCollision = false;
+
+    // A replay brings its own step settings and length.
+    Replay replay;
+    ReplayCursor replayCursor;
+    if (replayPath) {
+        char error[256];
+        if (!LoadReplay(replayPath, &replay, error, sizeof(error))) {
+            fprintf(stderr, "%s\n", error);
+            return 1;
+        }
+        ApplyReplaySettings(&replay, &table);
+        stepCount = (long long)replay.header.stepCount;
+    }
+
+    if (!PhysicsMatchesProfile(&table.physics)) {
+        fprintf(stderr, "physics settings differ from this build's fixed profile\n");
+        return 1;
+    }
+
+    if (!InitGameState(&table, &state, ballCount + MULTIBALL_EXTRA_BALLS)) {
+        fprintf(stderr, "out of memory for %d balls\n", ballCount);
+        return 1;
+    }
+    SpawnBatch(&table, &state, ballCount);
+
+    if (replayPath) {
+        char error[256];
+        if (!StartReplayPlayback(&replay, &table, &state, &replayCursor, error, sizeof(error))) {
+            fprintf(stderr, "%s: %s\n", replayPath, error);
+            return 1;
+        }
+    } else if (recordPath) {
+        BeginReplayRecording(&replay, &table, &state);
+    }
+
+    long long collisionSteps = 0, drains = 0;
+    double startTime = TimerNowSeconds();
+
+    for (long long step = 0; step < stepCount; step++) {
+        unsigned int inputMask = 0;
+        if (replayPath) NextReplayInput(&replay, &replayCursor, &inputMask);
+        else inputMask = ReactiveFlipperInput(&table, &state, 30.0f);
+        if (recordPath && !RecordReplayStep(&replay, inputMask)) {
+            fprintf(stderr, "out of memory while recording\n");
+            return 1;
+        }
+        int events = StepPhysics(&table, &state, inputMask);
+#if defined(PINBALL_PROFILE)
+        ProfilerEndFrame(&activeProfiler);
+#endif
+        if (events & STEP_EVENT_COLLISION) collisionSteps++;
+        if (events & STEP_EVENT_DRAIN) drains++;
+    }
+
+    double elapsed = TimerNowSeconds() - startTime;
+    if (elapsed <= 0.0) elapsed = 1e-9;
+
+    printf("kernel:         %s, %d lanes, %s physics\n", SIMD_KERNEL_NAME, SIMD_LANES, PHYSICS_PROFILE_NAME);
+    printf("balls:          %d (final %d, peak %d)\n", ballCount, state.balls.count, state.balls.peakCount);
+    printf("step rate:      %.0f Hz, ccd %s\n", 1.0f / table.physics.fixedDeltaTime, table.physics.continuousCollision ? "on" : "off");
+    printf("steps:          %lld\n", stepCount);
+    printf("simulated time: %.1f s\n", stepCount * (double)table.physics.fixedDeltaTime);
+    printf("wall time:      %.3f s\n", elapsed);
+    printf("steps/sec:      %.0f\n", stepCount / elapsed);
+    printf("ns/substep:     %.2f (%.2f per ball)\n", elapsed * 1e9 / stepCount, elapsed * 1e9 / stepCount / ballCount);
+    printf("collisions:     %lld steps, drains: %lld\n", collisionSteps, drains);
+    printf("final ball:     x=%.3f y=%.3f vx=%.3f vy=%.3f score=%d\n",
+           state.balls.x[0], state.balls.y[0], state.balls.velocityX[0], state.balls.velocityY[0], state.score);
+    printf("checksum:       %08x\n", GameStateChecksum(&state));
+#if defined(PINBALL_PROFILE)
+    // Each step is one profiler frame here; stats cover the last PROFILE_WINDOW steps.
+    for (int phase = PROFILE_FLIPPERS; phase <= PROFILE_RULES; phase++) {
+        ProfileStats stats = ProfilePhaseStats(&activeProfiler, phase);
+        printf("%-15s p50 %.3f us, p99 %.3f us, max %.3f us\n", profilePhaseNames[phase],
+               stats.p50 * 1e3f, stats.p99 * 1e3f, stats.max * 1e3f);
+    }
+    for (int i = 0; i < PROFILE_COUNTER_COUNT; i += 2) {
+        printf("%-15s %lld, %s %lld\n", profileCounterNames[i], activeProfiler.windowCounters[i],
+               profileCounterNames[i + 1], activeProfiler.windowCounters[i + 1]);
+    }
+#endif
+
+    int result = 0;
+    if (replayPath) {
+        bool matches = ReplayMatches(&replay, &state);
+        printf("replay:         %s (recorded %08x, score %d)\n", matches ? "match" : "MISMATCH",
+               replay.header.finalChecksum, replay.header.finalScore);
+        if (!matches) result = 1;
+        FreeReplay(&replay);
+    } else if (recordPath) {
+        FinishReplayRecording(&replay, &state);
+        if (SaveReplay(recordPath, &replay)) {
+            printf("recorded:       %s (%u runs)\n", recordPath, replay.header.runCount);
+        } else {
+            fprintf(stderr, "cannot write %s\n", recordPath);
+            result = 1;
+        }
+        FreeReplay(&replay);
+    }
+    FreeGameState(&state);
+    return result;
+}
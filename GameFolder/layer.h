@@ -0,0 +1,67 @@
+#ifndef PINBALL_LAYER_H
+#define PINBALL_LAYER_H
+
+#include "raylib.h"
+#include "physics.h"
+#include "atlas.h"
+
+// Everything on the playfield that never moves (background, planets and the
+// boundary segments) is drawn once into a render texture, and each frame
+// blits that single texture before the balls, flippers and HUD. Rebuild it
+// whenever the table or its assets change. renderScale is pixels per table
+// unit and should match the RenderView it is drawn into.
+
+typedef struct {
+    RenderTexture2D target;
+    int width;
+    int height;
+    float tableWidth;
+    float tableHeight;
+} StaticLayer;
+
+static inline void DrawSegments(const Table *table) {
+    for (int i = 0; i < table->segmentCount; i++) {
+        const Segment *segment = &table->segments[i];
+        DrawLineEx((Vector2){segment->start.x, segment->start.y}, (Vector2){segment->end.x, segment->end.y}, 6, WHITE);
+    }
+}
+
+static inline void UnloadStaticLayer(StaticLayer *layer) {
+    if (layer->target.id != 0) UnloadRenderTexture(layer->target);
+    layer->target = (RenderTexture2D){0};
+}
+
+static inline void BuildStaticLayer(StaticLayer *layer, const Table *table, Texture2D background,
+                                    const SpriteAtlas *atlas, float renderScale) {
+    int width = (int)ceilf(table->width * renderScale), height = (int)ceilf(table->height * renderScale);
+    if (layer->target.id == 0 || layer->width != width || layer->height != height) {
+        UnloadStaticLayer(layer);
+        layer->target = LoadRenderTexture(width, height);
+        layer->width = width;
+        layer->height = height;
+    }
+    layer->tableWidth = table->width;
+    layer->tableHeight = table->height;
+
+    BeginTextureMode(layer->target);
+    BeginMode2D((Camera2D){{0, 0}, {0, 0}, 0.0f, renderScale});
+    ClearBackground(BLACK);
+    if (background.id != 0) DrawTexture(background, 0, 0, WHITE);
+    DrawPlanets(table, atlas);
+    DrawSegments(table);
+    EndMode2D();
+    EndTextureMode();
+}
+
+// Render textures are stored bottom-up, hence the negative source height.
+// The layer already holds blended colours, so it is copied with premultiplied
+// blending: sprite edges keep their colour instead of being faded twice.
+static inline void DrawStaticLayer(const StaticLayer *layer) {
+    Rectangle source = {0, 0, (float)layer->width, -(float)layer->height};
+    Rectangle dest = {0, 0, layer->tableWidth, layer->tableHeight};
+    BeginBlendMode(BLEND_ALPHA_PREMULTIPLY);
+    DrawTexturePro(layer->target.texture, source, dest, (Vector2){0, 0}, 0.0f, WHITE);
+    EndBlendMode();
+}
+
+#endif
@@ -0,0 +1,168 @@
+#ifndef PINBALL_LOADER_H
+#define PINBALL_LOADER_H
+
+#include "raylib.h"
+#include "physics.h"
+#include "table.h"
+#include "atlas.h"
+#include "audio.h"
+#include "thread.h"
+#include <stdatomic.h>
+#include <string.h>
+
+// Decodes table assets on worker threads while the window is already up. Jobs
+// are claimed from a shared counter: the background image, the collision wave
+// and one job per distinct planet sprite. Whichever worker finishes the last
+// decode also packs the atlas image. Only the texture uploads are left
+// for the main thread in FinishAssetLoader.
+
+#define LOADER_MAX_WORKERS 4
+#define LOADER_JOB_BACKGROUND 0
+#define LOADER_JOB_SOUND 1
+#define LOADER_FIRST_SPRITE_JOB 2
+
+typedef struct {
+    const Table *table;
+    const TableAssets *assets;
+
+    Image background;
+    Wave collisionWave;
+    Image sprites[MAX_PLANETS];
+    int spriteJobs[MAX_PLANETS];
+    int owner[MAX_PLANETS];
+    int tileCount;
+    int tileSize;
+    Image atlasImage;
+    SpriteAtlas atlas;
+
+    int jobCount;
+    atomic_int nextJob;
+    atomic_int finishedJobs;
+    atomic_bool ready;
+    Thread workers[LOADER_MAX_WORKERS];
+    int workerCount;
+} AssetLoader;
+
+// Missing files only cost their asset: the table plays on black, or silent.
+static inline Image LoadTableBackground(const TableAssets *assets) {
+    if (assets->background[0] == '\0') return (Image){0};
+    Image background = LoadImage(assets->background);
+    if (background.data == NULL) TraceLog(LOG_WARNING, "LOADER: background %s missing", assets->background);
+    return background;
+}
+
+static inline Wave LoadCollisionWave(const TableAssets *assets) {
+    if (assets->collisionSound[0] == '\0') return (Wave){0};
+    Wave wave = LoadWave(assets->collisionSound);
+    if (wave.data == NULL) TraceLog(LOG_WARNING, "LOADER: sound %s missing", assets->collisionSound);
+    else WaveFormat(&wave, MIXER_SAMPLE_RATE, 32, 1);
+    return wave;
+}
+
+static void RunLoaderJob(AssetLoader *loader, int job) {
+    if (job == LOADER_JOB_BACKGROUND) {
+        loader->background = LoadTableBackground(loader->assets);
+    } else if (job == LOADER_JOB_SOUND) {
+        loader->collisionWave = LoadCollisionWave(loader->assets);
+    } else {
+        int planet = loader->spriteJobs[job - LOADER_FIRST_SPRITE_JOB];
+        loader->sprites[planet] = LoadAtlasSprite(loader->assets->planetTextures[planet], loader->tileSize);
+    }
+}
+
+static int AssetLoaderWorker(void *argument) {
+    AssetLoader *loader = (AssetLoader *)argument;
+    for (;;) {
+        int job = atomic_fetch_add(&loader->nextJob, 1);
+        if (job >= loader->jobCount) break;
+        RunLoaderJob(loader, job);
+
+        // The release/acquire pair on finishedJobs makes every decoded image
+        // visible to the worker that packs the atlas.
+        if (atomic_fetch_add(&loader->finishedJobs, 1) + 1 == loader->jobCount) {
+            loader->atlasImage = PackAtlasSprites(loader->table, loader->owner, loader->sprites,
+                                                  loader->tileCount, loader->tileSize, &loader->atlas);
+            for (int i = 0; i < loader->table->planetCount; i++) {
+                if (loader->sprites[i].data != NULL) UnloadImage(loader->sprites[i]);
+                loader->sprites[i] = (Image){0};
+            }
+            atomic_store(&loader->ready, true);
+        }
+    }
+    return 0;
+}
+
+static inline void StartAssetLoader(AssetLoader *loader, const Table *table, const TableAssets *assets) {
+    memset(loader, 0, sizeof(*loader));
+    loader->table = table;
+    loader->assets = assets;
+    loader->tileCount = PlanAtlasTiles(table, assets, loader->owner, &loader->tileSize);
+
+    int spriteCount = 0;
+    for (int i = 0; i < table->planetCount; i++) {
+        if (loader->owner[i] == i) loader->spriteJobs[spriteCount++] = i;
+    }
+    loader->jobCount = LOADER_FIRST_SPRITE_JOB + spriteCount;
+    atomic_init(&loader->nextJob, 0);
+    atomic_init(&loader->finishedJobs, 0);
+    atomic_init(&loader->ready, false);
+
+    int workerCount = ThreadHardwareConcurrency() - 1;
+    if (workerCount < 1) workerCount = 1;
+    if (workerCount > LOADER_MAX_WORKERS) workerCount = LOADER_MAX_WORKERS;
+    if (workerCount > loader->jobCount) workerCount = loader->jobCount;
+    for (int i = 0; i < workerCount; i++) {
+        if (ThreadStart(&loader->workers[loader->workerCount], AssetLoaderWorker, loader)) loader->workerCount++;
+    }
+
+    // Without any worker the loader degrades to loading in place.
+    if (loader->workerCount == 0) AssetLoaderWorker(loader);
+}
+
+static inline float AssetLoaderProgress(const AssetLoader *loader) {
+    // One extra unit for packing so the bar only fills once the atlas is ready.
+    int finished = atomic_load(&loader->finishedJobs) + (atomic_load(&loader->ready) ? 1 : 0);
+    return (float)finished / (float)(loader->jobCount + 1);
+}
+
+static inline bool AssetLoaderReady(const AssetLoader *loader) {
+    return atomic_load(&loader->ready);
+}
+
+// Joins the workers and performs the uploads that must happen on the thread
+// owning the GL context. The collision wave is handed over already converted
+// to the mixer format; the caller unloads it.
+static inline void FinishAssetLoader(AssetLoader *loader, Texture2D *background, Wave *collisionWave, SpriteAtlas *atlas) {
+    for (int i = 0; i < loader->workerCount; i++) ThreadJoin(loader->workers[i]);
+    loader->workerCount = 0;
+
+    *background = (Texture2D){0};
+    if (loader->background.data != NULL) {
+        *background = LoadTextureFromImage(loader->background);
+        UnloadImage(loader->background);
+    }
+
+    *collisionWave = loader->collisionWave;
+    loader->collisionWave = (Wave){0};
+
+    *atlas = loader->atlas;
+    UploadSpriteAtlas(atlas, loader->atlasImage);
+    if (loader->atlasImage.data != NULL) UnloadImage(loader->atlasImage);
+    loader->atlasImage = (Image){0};
+}
+
+static inline void DrawLoadingScreen(const AssetLoader *loader, int screenWidth, int screenHeight) {
+    float barWidth = screenWidth * 0.6f;
+    float barHeight = 16.0f;
+    float barX = (screenWidth - barWidth) * 0.5f;
+    float barY = screenHeight * 0.5f;
+
+    BeginDrawing();
+    ClearBackground(BLACK);
+    DrawText("LOADING", (int)barX, (int)barY - 36, 24, RAYWHITE);
+    DrawRectangleLines((int)barX, (int)barY, (int)barWidth, (int)barHeight, RAYWHITE);
+    DrawRectangle((int)barX + 2, (int)barY + 2, (int)((barWidth - 4) * AssetLoaderProgress(loader)), (int)barHeight - 4, RAYWHITE);
+    EndDrawing();
+}
+
+#endif
@@ -1,401 +1,598 @@
-#include "raylib.h"
-#include <math.h>
-#include <stdio.h>
-#include <stdlib.h>
-
-typedef struct {
-    float x;
-    float y;
-    float radius;
-    Texture2D texture;
-} Planet;
-
-typedef struct {
-    float x;
-    float y;
-} Vec2f;
-
-typedef struct {
-    Vec2f pivotPoint;
-    float length;
-    float width;
-    float currentAngle;      
-    float restingAngle;  
-    float activeAngle;  
-    float rotationSpeedDeg;  
-    bool isLeftFlipper;
-    Color color;
-} Flipper;
-
-typedef struct {
-    float x;
-    float y;
-    float radius;
-    float velocityX;
-    float velocityY;
-} Ball;
-
-static Vec2f RotatePoint(Vec2f point, Vec2f pivot, float angle) {
-    float sinAngle = sinf(angle), cosAngle = cosf(angle);
-    float translatedX = point.x - pivot.x;
-    float translatedY = point.y - pivot.y;
-    Vec2f rotatedPoint = { 
-        translatedX * cosAngle - translatedY * sinAngle + pivot.x, 
-        translatedX * sinAngle + translatedY * cosAngle + pivot.y 
-    };
-    return rotatedPoint;
-}
-
-static float ClosestPointOnSegment(Vec2f segmentStart, Vec2f segmentEnd, Vec2f point, Vec2f *closestPoint) {
-    float segmentDirX = segmentEnd.x - segmentStart.x;
-    float segmentDirY = segmentEnd.y - segmentStart.y;
-    float pointDirX = point.x - segmentStart.x;
-    float pointDirY = point.y - segmentStart.y;
-    float segmentLengthSquared = segmentDirX * segmentDirX + segmentDirY * segmentDirY;
-    float projectionParameter = 0.0f;
-    
-    if (segmentLengthSquared > 1e-8f) {
-        projectionParameter = (pointDirX * segmentDirX + pointDirY * segmentDirY) / segmentLengthSquared;
-    }
-    
-    if (projectionParameter < 0.0f) projectionParameter = 0.0f;
-    if (projectionParameter > 1.0f) projectionParameter = 1.0f;
-    
-    if (closestPoint) { 
-        closestPoint->x = segmentStart.x + segmentDirX * projectionParameter; 
-        closestPoint->y = segmentStart.y + segmentDirY * projectionParameter; 
-    }
-    return projectionParameter;
-}
-
-static bool CircleSegmentCollision(Vec2f segmentStart, Vec2f segmentEnd, Ball *ball) {
-    Vec2f closestPoint;
-    ClosestPointOnSegment(segmentStart, segmentEnd, (Vec2f){ball->x, ball->y}, &closestPoint);
-    float deltaX = ball->x - closestPoint.x;
-    float deltaY = ball->y - closestPoint.y;
-    float distanceSquared = deltaX * deltaX + deltaY * deltaY;
-    return (distanceSquared <= (ball->radius * ball->radius));
-}
-
-static void ReflectVelocity(Ball *ball, float normalX, float normalY, float bounceFactor) {
-    float dotProduct = ball->velocityX * normalX + ball->velocityY * normalY;
-    ball->velocityX -= 2.0f * dotProduct * normalX;
-    ball->velocityY -= 2.0f * dotProduct * normalY;
-    ball->velocityX *= bounceFactor;
-    ball->velocityY *= bounceFactor;
-}
-
-static void SeparateCircleFromSegment(Ball *ball, Vec2f segmentStart, Vec2f segmentEnd) {
-    Vec2f closestPoint;
-    ClosestPointOnSegment(segmentStart, segmentEnd, (Vec2f){ball->x, ball->y}, &closestPoint);
-    float deltaX = ball->x - closestPoint.x;
-    float deltaY = ball->y - closestPoint.y;
-    float distance = sqrtf(deltaX * deltaX + deltaY * deltaY);
-    
-    if (distance < 1e-5f) distance = 1e-5f;
-    
-    if (distance < ball->radius) {
-        float normalX = deltaX / distance;
-        float normalY = deltaY / distance;
-        ball->x = closestPoint.x + normalX * ball->radius;
-        ball->y = closestPoint.y + normalY * ball->radius;
-    }
-}
-
-static void DrawFlipper(const Flipper *flipper) {
-    Vec2f startPoint = flipper->pivotPoint;
-    Vec2f endPoint = { 
-        flipper->pivotPoint.x + flipper->length * cosf(flipper->currentAngle), 
-        flipper->pivotPoint.y + flipper->length * sinf(flipper->currentAngle) 
-    };
-    DrawLineEx((Vector2){startPoint.x, startPoint.y}, (Vector2){endPoint.x, endPoint.y}, flipper->width, flipper->color);
-    DrawCircleV((Vector2){startPoint.x, startPoint.y}, flipper->width * 0.5f, flipper->color);
-    DrawCircleV((Vector2){endPoint.x, endPoint.y}, flipper->width * 0.5f, flipper->color);
-}
-
-int main(void) {
-    const int SCREEN_WIDTH = 600, SCREEN_HEIGHT = 900;
-    InitWindow(SCREEN_WIDTH, SCREEN_HEIGHT, "SPACE PINBALL");
-    SetTargetFPS(60);
-    InitAudioDevice();
-
-    Texture2D background = LoadTexture("spacebg.jpg");
-    Sound collisionSound = LoadSound("hit.wav");
-
-    const int PLANET_COUNT = 6;
-    Planet planets[PLANET_COUNT];
-    planets[0] = (Planet){270, 320, 85, LoadTexture("earth.png")};
-    planets[1] = (Planet){480, 120, 55, LoadTexture("mars.png")};
-    planets[2] = (Planet){90, 120, 75, LoadTexture("jup.png")};
-    planets[3] = (Planet){480, 320, 48, LoadTexture("nep.png")};
-    planets[4] = (Planet){65, 470, 52, LoadTexture("uranus.png")};
-    planets[5] = (Planet){500, 500, 50, LoadTexture("venus.png")};
-
-    Ball ball = {460.0f, 450.0f, 14.0f, 0.0f, 0.0f};
-
-    Flipper leftFlipper = {
-        {SCREEN_WIDTH / 2.0f - 100.0f, SCREEN_HEIGHT - 150.0f}, 
-        80.0f, 15.0f,
-        15.0f * DEG2RAD, 15.0f * DEG2RAD, -45.0f * DEG2RAD, 
-        480.0f, true, LIGHTGRAY
-    };
-    
-    Flipper rightFlipper = {
-        {SCREEN_WIDTH / 2.0f + 100.0f, SCREEN_HEIGHT - 150.0f}, 
-        80.0f, 15.0f,
-        165.0f * DEG2RAD, 165.0f * DEG2RAD, 225.0f * DEG2RAD, 
-        480.0f, false, LIGHTGRAY
-    };
-
-    int score = 0;
-    bool playCollisionSound = false;
-
-    const float GRAVITY_ACCELERATION = 1200.0f;
-    const float WALL_BOUNCE_FACTOR = 0.7f;
-    const float PLANET_BOUNCE_FACTOR = 0.85f;
-    const float FLIPPER_BOUNCE_FACTOR = 0.90f;
-    const float FLIPPER_IMPULSE_STRENGTH = 280.0f;
-    const float FLIPPER_VELOCITY_TRANSFER = 0.5f;
-    const int PHYSICS_SUBSTEPS = 6;
-
-    while (!WindowShouldClose()) {
-        float frameTime = GetFrameTime();
-        playCollisionSound = false;
-        
-        bool leftFlipperActive = IsKeyDown(KEY_LEFT);
-        bool rightFlipperActive = IsKeyDown(KEY_RIGHT);
-
-        float leftTargetAngle = leftFlipperActive ? leftFlipper.activeAngle : leftFlipper.restingAngle;
-        float rightTargetAngle = rightFlipperActive ? rightFlipper.activeAngle : rightFlipper.restingAngle;
-        
-        float rotationSpeedRad = leftFlipper.rotationSpeedDeg * DEG2RAD;
-        
-        if (leftFlipper.currentAngle < leftTargetAngle) {
-            leftFlipper.currentAngle += rotationSpeedRad * frameTime;
-            if (leftFlipper.currentAngle > leftTargetAngle) leftFlipper.currentAngle = leftTargetAngle;
-        } else if (leftFlipper.currentAngle > leftTargetAngle) {
-            leftFlipper.currentAngle -= rotationSpeedRad * frameTime;
-            if (leftFlipper.currentAngle < leftTargetAngle) leftFlipper.currentAngle = leftTargetAngle;
-        }
-        
-        if (rightFlipper.currentAngle < rightTargetAngle) {
-            rightFlipper.currentAngle += rotationSpeedRad * frameTime;
-            if (rightFlipper.currentAngle > rightTargetAngle) rightFlipper.currentAngle = rightTargetAngle;
-        } else if (rightFlipper.currentAngle > rightTargetAngle) {
-            rightFlipper.currentAngle -= rotationSpeedRad * frameTime;
-            if (rightFlipper.currentAngle < rightTargetAngle) rightFlipper.currentAngle = rightTargetAngle;
-        }
-
-        for (int substep = 0; substep < PHYSICS_SUBSTEPS; substep++) {
-            float substepDeltaTime = frameTime / (float)PHYSICS_SUBSTEPS;
-
-            ball.velocityY += GRAVITY_ACCELERATION * substepDeltaTime;
-            ball.x += ball.velocityX * substepDeltaTime;
-            ball.y += ball.velocityY * substepDeltaTime;
-
-            if (ball.x - ball.radius < 0) { 
-                ball.x = ball.radius; 
-                ball.velocityX *= -WALL_BOUNCE_FACTOR; 
-            }
-            if (ball.x + ball.radius > SCREEN_WIDTH) { 
-                ball.x = SCREEN_WIDTH - ball.radius; 
-                ball.velocityX *= -WALL_BOUNCE_FACTOR; 
-            }
-            if (ball.y - ball.radius < 0) { 
-                ball.y = ball.radius; 
-                ball.velocityY *= -WALL_BOUNCE_FACTOR; 
-            }
-            
-            if (ball.y > SCREEN_HEIGHT + 100) { 
-                ball.x = 300; 
-                ball.y = 450; 
-                ball.velocityX = 0; 
-                ball.velocityY = 0; 
-                score = 0; 
-            }
-
-            float boundaryYCenter = leftFlipper.pivotPoint.y - 35.0f;
-            float boundarySlope = 20.0f;
-            Vec2f leftBoundaryStart = {0, boundaryYCenter - boundarySlope};
-            Vec2f leftBoundaryEnd = {leftFlipper.pivotPoint.x, boundaryYCenter + boundarySlope};
-            Vec2f rightBoundaryStart = {rightFlipper.pivotPoint.x, boundaryYCenter + boundarySlope};
-            Vec2f rightBoundaryEnd = {(float)SCREEN_WIDTH, boundaryYCenter - boundarySlope};
-            
-            SeparateCircleFromSegment(&ball, leftBoundaryStart, leftBoundaryEnd);
-            SeparateCircleFromSegment(&ball, rightBoundaryStart, rightBoundaryEnd);
-
-            Flipper flippers[2] = {leftFlipper, rightFlipper};
-            bool flipperActive[2] = {leftFlipperActive, rightFlipperActive};
-            int flipperBaseScore[2] = {10, 15};
-            
-            for (int flipperIndex = 0; flipperIndex < 2; flipperIndex++) {
-                Flipper *currentFlipper = &flippers[flipperIndex];
-                bool hasCollided = false;
-                
-                Vec2f flipperStartPos = currentFlipper->pivotPoint;
-                Vec2f flipperEndPos = {
-                    currentFlipper->pivotPoint.x + currentFlipper->length * cosf(currentFlipper->currentAngle),
-                    currentFlipper->pivotPoint.y + currentFlipper->length * sinf(currentFlipper->currentAngle)
-                };
-                float capRadius = currentFlipper->width * 0.5f;
-                
-                float deltaXToTip = ball.x - flipperEndPos.x;
-                float deltaYToTip = ball.y - flipperEndPos.y;
-                float distanceToTip = sqrtf(deltaXToTip * deltaXToTip + deltaYToTip * deltaYToTip);
-                
-                if (distanceToTip < ball.radius + capRadius && !hasCollided) {
-                    if (distanceToTip < 1e-5f) distanceToTip = 1e-5f;
-                    float normalX = deltaXToTip / distanceToTip;
-                    float normalY = deltaYToTip / distanceToTip;
-                    
-                    if (flipperActive[flipperIndex]) {
-                        ball.velocityX += normalX * FLIPPER_IMPULSE_STRENGTH * substepDeltaTime;
-                        ball.velocityY += normalY * FLIPPER_IMPULSE_STRENGTH * substepDeltaTime;
-                        
-                        float angularDirection = (currentFlipper->currentAngle - currentFlipper->restingAngle) > 0 ? 1.0f : -1.0f;
-                        float angularVelocity = angularDirection * currentFlipper->rotationSpeedDeg * DEG2RAD;
-                        float tipLinearVelocityX = -angularVelocity * (flipperEndPos.y - currentFlipper->pivotPoint.y);
-                        float tipLinearVelocityY = angularVelocity * (flipperEndPos.x - currentFlipper->pivotPoint.x);
-                        ball.velocityX += tipLinearVelocityX * FLIPPER_VELOCITY_TRANSFER;
-                        ball.velocityY += tipLinearVelocityY * FLIPPER_VELOCITY_TRANSFER;
-                    } else {
-                        ReflectVelocity(&ball, normalX, normalY, FLIPPER_BOUNCE_FACTOR);
-                    }
-                    
-                    ball.x = flipperEndPos.x + normalX * (ball.radius + capRadius);
-                    ball.y = flipperEndPos.y + normalY * (ball.radius + capRadius);
-                    score += flipperBaseScore[flipperIndex];
-                    hasCollided = true;
-                    playCollisionSound = true;
-                }
-                
-                if (!hasCollided && CircleSegmentCollision(flipperStartPos, flipperEndPos, &ball)) {
-                    Vec2f closestPoint;
-                    float segmentParameter = ClosestPointOnSegment(flipperStartPos, flipperEndPos, 
-                                                                   (Vec2f){ball.x, ball.y}, &closestPoint);
-                    
-                    float normalX = ball.x - closestPoint.x;
-                    float normalY = ball.y - closestPoint.y;
-                    float normalDistance = sqrtf(normalX * normalX + normalY * normalY);
-                    if (normalDistance < 1e-5f) normalDistance = 1e-5f;
-                    normalX /= normalDistance; 
-                    normalY /= normalDistance;
-                    
-                    if (flipperActive[flipperIndex]) {
-                        ball.velocityX += normalX * FLIPPER_IMPULSE_STRENGTH * substepDeltaTime;
-                        ball.velocityY += normalY * FLIPPER_IMPULSE_STRENGTH * substepDeltaTime;
-                        
-                        float angularDirection = (currentFlipper->currentAngle - currentFlipper->restingAngle) > 0 ? 1.0f : -1.0f;
-                        float angularVelocity = angularDirection * currentFlipper->rotationSpeedDeg * DEG2RAD;
-                        float contactLinearVelocityX = -angularVelocity * (closestPoint.y - currentFlipper->pivotPoint.y);
-                        float contactLinearVelocityY = angularVelocity * (closestPoint.x - currentFlipper->pivotPoint.x);
-                        ball.velocityX += contactLinearVelocityX * FLIPPER_VELOCITY_TRANSFER;
-                        ball.velocityY += contactLinearVelocityY * FLIPPER_VELOCITY_TRANSFER;
-                    } else {
-                        ReflectVelocity(&ball, normalX, normalY, FLIPPER_BOUNCE_FACTOR);
-                    }
-                    
-                    ball.x = closestPoint.x + normalX * ball.radius;
-                    ball.y = closestPoint.y + normalY * ball.radius;
-                    score += (int)(flipperBaseScore[flipperIndex] * (0.5f + segmentParameter * 0.5f));
-                    hasCollided = true;
-                    playCollisionSound = true;
-                }
-                
-                if (!hasCollided) {
-                    float deltaXToPivot = ball.x - flipperStartPos.x;
-                    float deltaYToPivot = ball.y - flipperStartPos.y;
-                    float distanceToPivot = sqrtf(deltaXToPivot * deltaXToPivot + deltaYToPivot * deltaYToPivot);
-                    
-                    if (distanceToPivot < ball.radius + capRadius) {
-                        if (distanceToPivot < 1e-5f) distanceToPivot = 1e-5f;
-                        float normalX = deltaXToPivot / distanceToPivot;
-                        float normalY = deltaYToPivot / distanceToPivot;
-                        
-                        if (flipperActive[flipperIndex]) {
-                            ball.velocityX += normalX * FLIPPER_IMPULSE_STRENGTH * substepDeltaTime;
-                            ball.velocityY += normalY * FLIPPER_IMPULSE_STRENGTH * substepDeltaTime;
-                        } else {
-                            ReflectVelocity(&ball, normalX, normalY, FLIPPER_BOUNCE_FACTOR);
-                        }
-                        
-                        ball.x = flipperStartPos.x + normalX * (ball.radius + capRadius);
-                        ball.y = flipperStartPos.y + normalY * (ball.radius + capRadius);
-                        score += flipperBaseScore[flipperIndex] / 2;
-                        hasCollided = true;
-                        playCollisionSound = true;
-                    }
-                }
-            }
-
-            for (int planetIndex = 0; planetIndex < PLANET_COUNT; planetIndex++) {
-                float deltaX = ball.x - planets[planetIndex].x;
-                float deltaY = ball.y - planets[planetIndex].y;
-                float distance = sqrtf(deltaX * deltaX + deltaY * deltaY);
-                float minimumDistance = ball.radius + planets[planetIndex].radius;
-                
-                if (distance < minimumDistance && distance > 1e-5f) {
-                    float normalX = deltaX / distance;
-                    float normalY = deltaY / distance;
-                    
-                    ReflectVelocity(&ball, normalX, normalY, PLANET_BOUNCE_FACTOR);
-                    
-                    ball.x = planets[planetIndex].x + normalX * minimumDistance;
-                    ball.y = planets[planetIndex].y + normalY * minimumDistance;
-                    score += 5;
-                    playCollisionSound = true;
-                }
-            }
-        }
-
-        if (playCollisionSound) {
-            PlaySound(collisionSound);
-        }
-
-        BeginDrawing();
-        ClearBackground(BLACK);
-        if (background.id != 0) DrawTexture(background, 0, 0, WHITE);
-
-        for (int i = 0; i < PLANET_COUNT; i++) {
-            if (planets[i].texture.id != 0) {
-                Rectangle sourceRect = {0, 0, (float)planets[i].texture.width, (float)planets[i].texture.height};
-                Rectangle destRect = {
-                    planets[i].x - planets[i].radius, 
-                    planets[i].y - planets[i].radius, 
-                    planets[i].radius * 2, 
-                    planets[i].radius * 2
-                };
-                DrawTexturePro(planets[i].texture, sourceRect, destRect, (Vector2){0, 0}, 0, WHITE);
-            } else {
-                DrawCircle((int)planets[i].x, (int)planets[i].y, planets[i].radius, DARKBLUE);
-            }
-        }
-
-        float boundaryYDraw = leftFlipper.pivotPoint.y - 35.0f;
-        float slopeDraw = 20.0f;
-        DrawLineEx((Vector2){0, boundaryYDraw - slopeDraw}, 
-                   (Vector2){leftFlipper.pivotPoint.x + 5, boundaryYDraw + slopeDraw}, 6, WHITE);
-        DrawLineEx((Vector2){rightFlipper.pivotPoint.x - 5, boundaryYDraw + slopeDraw}, 
-                   (Vector2){(float)SCREEN_WIDTH, boundaryYDraw - slopeDraw}, 6, WHITE);
-
-        DrawFlipper(&leftFlipper);
-        DrawFlipper(&rightFlipper);
-
-        DrawCircleV((Vector2){ball.x, ball.y}, ball.radius, WHITE);
-        
-        DrawText(TextFormat("Score: %d", score), 10, 10, 24, RAYWHITE);
-        
-        EndDrawing();
-    }
-
-    if (background.id != 0) UnloadTexture(background);
-    for (int i = 0; i < PLANET_COUNT; i++) {
-        if (planets[i].texture.id != 0) UnloadTexture(planets[i].texture);
-    }
-    
-    UnloadSound(collisionSound);
-    CloseAudioDevice();
-    CloseWindow();
-    return 0;
-
-}
+#include "raylib.h"
+#include "physics.h"
+#include "table.h"
+#include "arena.h"
+#include "atlas.h"
+#include "layer.h"
+#include "loader.h"
+#include "net.h"
+#include "audio.h"
+#include "events.h"
+#include "particles.h"
+#include "reload.h"
+#include "replay.h"
+#include "scores.h"
+#include "sim.h"
+#include "view.h"
+#include "timer.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_ACTIVE_BALLS 16
+#define SESSION_ARENA_BYTES (1024 * 1024)
+#define TARGET_FRAME_SECONDS (1.0 / 60.0)
+#define INPUT_POLL_SECONDS 0.001
+#define IDLE_FRAME_SECONDS (1.0 / 20.0)
+#define IDLE_POLL_SECONDS 0.004
+#define DEFAULT_IDLE_SECONDS 60.0
+#define SLOW_FRAME_FACTOR 1.5
+
+typedef struct {
+    unsigned int sentMask;
+    bool showProfiler;
+    double lastInputTime;
+} InputSampler;
+
+// Called once per frame and again about every millisecond while the frame
+// waits, right after raylib refreshed its key state, so a press is stamped
+// within a millisecond of reaching the platform event queue rather than at
+// the next frame start. Returns whether any key is held or was pressed.
+static bool SampleInput(Simulation *sim, InputSampler *sampler) {
+    unsigned int inputMask = 0;
+    if (IsKeyDown(KEY_LEFT)) inputMask |= INPUT_LEFT_FLIPPER;
+    if (IsKeyDown(KEY_RIGHT)) inputMask |= INPUT_RIGHT_FLIPPER;
+    if (inputMask != sampler->sentMask && PushInputEvent(sim, TimerNowSeconds(), inputMask)) sampler->sentMask = inputMask;
+    if (IsKeyPressed(KEY_F3)) sampler->showProfiler = !sampler->showProfiler;
+
+    bool active = inputMask != 0 || GetKeyPressed() != 0;
+    if (active) sampler->lastInputTime = TimerNowSeconds();
+    return active;
+}
+
+// Attract mode: after a stretch without input the cabinet loops a recorded
+// replay on its own copy of the table and state, rendered at a reduced rate.
+// The live game is reset when a player walks up.
+typedef struct {
+    Replay replay;
+    ReplayCursor cursor;
+    Table table;
+    GameState state;
+    bool loaded;
+    bool active;
+} AttractMode;
+
+static bool LoadAttractMode(AttractMode *attract, const char *path, const Table *table, Arena *arena) {
+    char error[256];
+    if (!LoadReplay(path, &attract->replay, error, sizeof(error))) {
+        TraceLog(LOG_WARNING, "ATTRACT: %s", error);
+        return false;
+    }
+    float *ballStorage = (float *)ArenaAlloc(arena, (size_t)MAX_ACTIVE_BALLS * BALL_BATCH_FIELDS * sizeof(float));
+    if (!ballStorage) {
+        FreeReplay(&attract->replay);
+        return false;
+    }
+    attract->table = *table;
+    ApplyReplaySettings(&attract->replay, &attract->table);
+    InitGameStateWithStorage(&attract->table, &attract->state, ballStorage, MAX_ACTIVE_BALLS);
+    attract->loaded = true;
+    return true;
+}
+
+static bool StartAttractPlayback(AttractMode *attract, Simulation *sim, CollisionEventQueue *collisionEvents) {
+    char error[256];
+    if (!StartReplayPlayback(&attract->replay, &attract->table, &attract->state, &attract->cursor, error, sizeof(error))) {
+        TraceLog(LOG_WARNING, "ATTRACT: %s", error);
+        return false;
+    }
+    return StartSimulation(sim, &attract->table, &attract->state, collisionEvents, &attract->replay, &attract->cursor,
+                           true, false, 1, NULL, NULL);
+}
+
+static void DrawFlipper(const Flipper *flipper, const FlipperPose *pose, Color color) {
+    Vec2f startPoint = flipper->pivotPoint;
+    Vec2f endPoint = pose->tip;
+    DrawLineEx((Vector2){startPoint.x, startPoint.y}, (Vector2){endPoint.x, endPoint.y}, flipper->width, color);
+    DrawCircleV((Vector2){startPoint.x, startPoint.y}, flipper->width * 0.5f, color);
+    DrawCircleV((Vector2){endPoint.x, endPoint.y}, flipper->width * 0.5f, color);
+}
+
+#if defined(PINBALL_PROFILE)
+static void DrawProfilerOverlay(const Profiler *profiler, int screenWidth) {
+    int x = screenWidth - 330, y = 10;
+    DrawRectangle(x - 8, y - 4, 328, 22 + 14 * (PROFILE_PHASE_COUNT + 1) + 14 * (PROFILE_COUNTER_COUNT / 2), Fade(BLACK, 0.7f));
+    DrawText("phase           p50     p99     max (ms)", x, y, 10, GREEN);
+    y += 16;
+    for (int phase = -1; phase < PROFILE_PHASE_COUNT; phase++) {
+        ProfileStats stats = ProfilePhaseStats(profiler, phase);
+        const char *name = phase < 0 ? "frame" : profilePhaseNames[phase];
+        DrawText(TextFormat("%-12s %7.3f %7.3f %7.3f", name, stats.p50, stats.p99, stats.max), x, y, 10, RAYWHITE);
+        y += 14;
+    }
+    for (int i = 0; i < PROFILE_COUNTER_COUNT; i += 2) {
+        DrawText(TextFormat("%-14s %9lld %-13s %7lld", profileCounterNames[i], profiler->windowCounters[i],
+                            profileCounterNames[i + 1], profiler->windowCounters[i + 1]), x, y, 10, RAYWHITE);
+        y += 14;
+    }
+}
+#endif
+
+int main(int argc, char **argv) {
+    const char *tablePath = "default.table";
+    const char *recordPath = NULL;
+    const char *replayPath = NULL;
+    const char *attractPath = NULL;
+    const char *scoresPath = "scores.log";
+    double idleSeconds = DEFAULT_IDLE_SECONDS;
+    int replaySpeed = 1;
+    int hostPort = 0;
+    const char *spectateAddress = NULL;
+    const char *versusAddress = NULL;
+    int windowWidth = 0, windowHeight = 0;
+    float renderScale = 1.0f;
+    bool watchTable = false;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--record") == 0 && i + 1 < argc) recordPath = argv[++i];
+        else if (strcmp(argv[i], "--replay") == 0 && i + 1 < argc) replayPath = argv[++i];
+        else if (strcmp(argv[i], "--speed") == 0 && i + 1 < argc) replaySpeed = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--attract") == 0 && i + 1 < argc) attractPath = argv[++i];
+        else if (strcmp(argv[i], "--idle-seconds") == 0 && i + 1 < argc) idleSeconds = atof(argv[++i]);
+        else if (strcmp(argv[i], "--scores") == 0 && i + 1 < argc) scoresPath = argv[++i];
+        else if (strcmp(argv[i], "--host") == 0 && i + 1 < argc) hostPort = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--spectate") == 0 && i + 1 < argc) spectateAddress = argv[++i];
+        else if (strcmp(argv[i], "--versus") == 0 && i + 1 < argc) versusAddress = argv[++i];
+        else if (strcmp(argv[i], "--window") == 0 && i + 1 < argc) sscanf(argv[++i], "%dx%d", &windowWidth, &windowHeight);
+        else if (strcmp(argv[i], "--render-scale") == 0 && i + 1 < argc) renderScale = (float)atof(argv[++i]);
+        else if (strcmp(argv[i], "--watch") == 0) watchTable = true;
+#if defined(PINBALL_PROFILE)
+        else if (strcmp(argv[i], "--profile-csv") == 0 && i + 1 < argc) {
+            if (!ProfilerOpenCsv(&activeProfiler, argv[++i])) TraceLog(LOG_WARNING, "PROFILE: cannot write %s", argv[i]);
+        }
+#endif
+        else tablePath = argv[i];
+    }
+    if (replaySpeed < 1) replaySpeed = 1;
+    if (renderScale < 0.1f || renderScale > 8.0f) renderScale = 1.0f;
+
+    TableFile tableFile;
+    char tableError[256];
+    bool tableOpened = watchTable ? OpenWatchedTable(tablePath, &tableFile, tableError, sizeof(tableError)) :
+                                    OpenTable(tablePath, &tableFile, tableError, sizeof(tableError));
+    if (!tableOpened) {
+        TraceLog(LOG_WARNING, "TABLE: %s, using built-in table", tableError);
+        OpenDefaultTable(&tableFile);
+    }
+    const Table *table = tableFile.table;
+    const TableAssets *assets = tableFile.assets;
+
+    // Playback runs on a copy of the table carrying the recorded step settings.
+    static Table replayTable;
+    Replay replay = {0};
+    ReplayCursor replayCursor = {0};
+    bool replaying = false;
+    if (replayPath) {
+        char replayError[256];
+        if (LoadReplay(replayPath, &replay, replayError, sizeof(replayError))) {
+            replayTable = *table;
+            ApplyReplaySettings(&replay, &replayTable);
+            table = &replayTable;
+            replaying = true;
+        } else {
+            TraceLog(LOG_WARNING, "REPLAY: %s", replayError);
+        }
+    }
+
+    // Ball, particle and attract storage is taken from one arena sized at
+    // startup and released in one piece at exit. It lives for the session:
+    // the table layout stays in the Table's own arrays, and a reload keeps
+    // using the storage taken here.
+    Arena sessionArena;
+    if (!InitArena(&sessionArena, SESSION_ARENA_BYTES)) return 1;
+    GameState state;
+    float *ballStorage = (float *)ArenaAlloc(&sessionArena, (size_t)MAX_ACTIVE_BALLS * BALL_BATCH_FIELDS * sizeof(float));
+    if (!ballStorage) return 1;
+    InitGameStateWithStorage(table, &state, ballStorage, MAX_ACTIVE_BALLS);
+
+    if (replaying) {
+        char replayError[256];
+        if (!StartReplayPlayback(&replay, table, &state, &replayCursor, replayError, sizeof(replayError))) {
+            TraceLog(LOG_WARNING, "REPLAY: %s: %s", replayPath, replayError);
+            FreeReplay(&replay);
+            replaying = false;
+        }
+    }
+    if (!replaying && recordPath) BeginReplayRecording(&replay, table, &state);
+
+    // A spectator only draws what the host sends. Streams have to start from a
+    // reset table, so replays are not served.
+    NetAddress spectateHost, versusHost;
+    bool spectating = spectateAddress && !replaying;
+    if (spectating && !NetParseAddress(spectateAddress, &spectateHost)) {
+        TraceLog(LOG_WARNING, "NET: bad address %s", spectateAddress);
+        spectating = false;
+    }
+    bool hosting = hostPort > 0 && hostPort < 65536 && !replaying && !spectating;
+    bool versus = versusAddress && !replaying && !spectating;
+    if (versus && !NetParseAddress(versusAddress, &versusHost)) {
+        TraceLog(LOG_WARNING, "NET: bad address %s", versusAddress);
+        versus = false;
+    }
+    if ((hostPort > 0 || versusAddress) && replaying) TraceLog(LOG_WARNING, "NET: not available during replay playback");
+
+    // Attract playback would interrupt a recording, a replay being watched or
+    // a streamed game.
+    static AttractMode attract;
+    if (attractPath && !replaying && !recordPath && !spectating && !hosting && !versus) {
+        LoadAttractMode(&attract, attractPath, table, &sessionArena);
+    }
+
+    // Editing is for plain live play: recordings, replays, streams and the
+    // attract loop all assume the table stays put.
+    bool watching = watchTable && !replaying && !recordPath && !spectating && !hosting && !versus && !attractPath;
+    if (watchTable && !watching) TraceLog(LOG_WARNING, "RELOAD: --watch only works in plain live play");
+    static TableWatcher tableWatcher;
+    if (watching) StartTableWatcher(&tableWatcher, tablePath, table, assets);
+
+    // The window defaults to one pixel per table unit and can be resized freely;
+    // the playfield keeps its aspect and is letterboxed.
+    if (windowWidth <= 0 || windowHeight <= 0) {
+        windowWidth = (int)table->width;
+        windowHeight = (int)table->height;
+    }
+    SetConfigFlags(FLAG_WINDOW_RESIZABLE);
+    InitWindow(windowWidth, windowHeight, "SPACE PINBALL");
+    SetTargetFPS(60);
+    InitAudioDevice();
+
+    // Decoding runs on loader threads; the window keeps presenting a progress
+    // bar until everything is ready to upload.
+    static AssetLoader assetLoader;
+    StartAssetLoader(&assetLoader, table, assets);
+    while (!AssetLoaderReady(&assetLoader) && !WindowShouldClose()) {
+        DrawLoadingScreen(&assetLoader, GetScreenWidth(), GetScreenHeight());
+    }
+
+    Texture2D background;
+    Wave collisionWave;
+    SpriteAtlas planetAtlas;
+    FinishAssetLoader(&assetLoader, &background, &collisionWave, &planetAtlas);
+
+    RenderView renderView;
+    InitRenderView(&renderView, table, renderScale);
+    StaticLayer staticLayer = {0};
+    BuildStaticLayer(&staticLayer, table, background, &planetAtlas, renderScale);
+
+    static CollisionEventQueue collisionEvents;
+    static AudioMixer audioMixer;
+    InitCollisionEventQueue(&collisionEvents);
+    InitAudioMixer(&audioMixer, collisionWave, &collisionEvents, table->physics.fixedDeltaTime);
+    if (collisionWave.data != NULL) UnloadWave(collisionWave);
+    static ParticleSystem particles;
+    InitParticleSystem(&particles, &sessionArena, &collisionEvents);
+
+    // Only games played here are kept; replays and spectated games are not.
+    static ScoreStore scores;
+    bool keepingScores = !replaying && !spectating;
+    if (keepingScores && !OpenScoreStore(&scores, scoresPath)) {
+        TraceLog(LOG_WARNING, "SCORES: cannot write %s", scoresPath);
+        keepingScores = false;
+    }
+    if (keepingScores) TraceLog(LOG_INFO, "SCORES: %d on the board, best %d", scores.leaderboard.count, scores.bestScore);
+    int64_t sessionStartTime = (int64_t)time(NULL);
+    uint32_t gamesPlayed = 0;
+    FrameTally gameFrames = {0}, sessionFrames = {0};
+
+    static NetHost netHost;
+    if (hosting && !StartNetHost(&netHost, table, (uint16_t)hostPort)) {
+        TraceLog(LOG_WARNING, "NET: cannot serve on port %d", hostPort);
+        hosting = false;
+    }
+    StepRecordRing *liveStepOutput = hosting ? &netHost.steps : NULL;
+
+    static NetClient spectator;
+    static SimSnapshot spectatorSnapshot;
+    if (spectating && !StartNetClient(&spectator, table, spectateHost, NET_MODE_STATE, NULL)) {
+        TraceLog(LOG_ERROR, "NET: cannot open a socket");
+        return 1;
+    }
+    for (int i = 0; i < table->flipperCount; i++) {
+        spectatorSnapshot.flipperPoses[i] = ComputeFlipperPose(&table->flippers[i], table->flippers[i].currentAngle);
+        spectatorSnapshot.previousFlipperPoses[i] = spectatorSnapshot.flipperPoses[i];
+    }
+
+    // Head to head: the opponent's game runs here too, in lockstep with the
+    // flipper input their cabinet streams, so only the masks cross the network.
+    static NetClient opponentClient;
+    static Simulation opponent;
+    static GameState opponentState;
+    static CollisionEventQueue opponentEvents;
+    static StepInputQueue opponentInputs;
+    if (versus) {
+        float *opponentBalls = (float *)ArenaAlloc(&sessionArena, (size_t)MAX_ACTIVE_BALLS * BALL_BATCH_FIELDS * sizeof(float));
+        InitCollisionEventQueue(&opponentEvents);
+        InitStepInputQueue(&opponentInputs);
+        if (opponentBalls) InitGameStateWithStorage(table, &opponentState, opponentBalls, MAX_ACTIVE_BALLS);
+        versus = opponentBalls && StartNetClient(&opponentClient, table, versusHost, NET_MODE_INPUT, &opponentInputs);
+        if (versus && !StartSimulation(&opponent, table, &opponentState, &opponentEvents, NULL, NULL, false, false, 1,
+                                       NULL, &opponentInputs)) {
+            StopNetClient(&opponentClient);
+            versus = false;
+        }
+        if (!versus) TraceLog(LOG_WARNING, "NET: cannot follow the opponent at %s", versusAddress);
+    }
+
+    static Simulation simulation;
+    if (!spectating && !StartSimulation(&simulation, table, &state, &collisionEvents, &replay, &replayCursor,
+                                        replaying, recordPath != NULL && !replaying, replaySpeed, liveStepOutput, NULL)) {
+        TraceLog(LOG_ERROR, "SIM: cannot start the simulation thread");
+        return 1;
+    }
+    bool simulationRunning = !spectating;
+
+    InputSampler inputSampler = {0, true, TimerNowSeconds()};
+    bool replayReported = false;
+    bool idle = false;
+
+    // Frames are paced here instead of inside EndDrawing so that input can be
+    // polled while waiting for the next frame.
+    SetTargetFPS(0);
+    double nextFrameTime = TimerNowSeconds() + TARGET_FRAME_SECONDS;
+    double lastFrameTime = TimerNowSeconds();
+    double frameBudget = TARGET_FRAME_SECONDS;
+
+    while (!WindowShouldClose()) {
+        PROFILE_BEGIN(PROFILE_INPUT);
+        bool inputActive = SampleInput(&simulation, &inputSampler);
+        PROFILE_END(PROFILE_INPUT);
+
+        // Edits are applied between frames and only what changed is reloaded.
+        // The game carries on: balls, score and flipper angles are kept. The
+        // simulation only pauses for the table swap and a first sound load.
+        int reloadChanges = watching ? PollTableWatcher(&tableWatcher, TimerNowSeconds()) : 0;
+        if (reloadChanges != 0) {
+            double reloadStart = TimerNowSeconds();
+            TableFile editedFile;
+            if ((reloadChanges & RELOAD_TABLE) && !OpenWatchedTable(tablePath, &editedFile, tableError, sizeof(tableError))) {
+                TraceLog(LOG_WARNING, "RELOAD: %s, keeping the current table", tableError);
+                reloadChanges &= ~RELOAD_TABLE;
+            }
+            if (reloadChanges & RELOAD_TABLE) reloadChanges |= TableAssetChanges(table, assets, editedFile.table, editedFile.assets);
+
+            bool pauseSimulation = (reloadChanges & (RELOAD_TABLE | RELOAD_SOUND)) != 0;
+            if (pauseSimulation) StopSimulation(&simulation);
+            if (reloadChanges & RELOAD_TABLE) {
+                bool resized = editedFile.table->width != table->width || editedFile.table->height != table->height;
+                CloseTableFile(&tableFile);
+                tableFile = editedFile;
+                table = tableFile.table;
+                assets = tableFile.assets;
+                RebindGameState(table, &state);
+                WatchTableAssets(&tableWatcher, table, assets);
+                if (resized) {
+                    UnloadRenderView(&renderView);
+                    InitRenderView(&renderView, table, renderScale);
+                }
+            }
+            if (reloadChanges & RELOAD_SOUND) {
+                Wave wave = LoadCollisionWave(assets);
+                // The callback has not taken the previous sample yet; retry on the next poll.
+                if (!ReplaceMixerSample(&audioMixer, wave, &collisionEvents, table->physics.fixedDeltaTime)) {
+                    tableWatcher.sound.applied = (FileStamp){0};
+                }
+                if (wave.data != NULL) UnloadWave(wave);
+            }
+            if (pauseSimulation) simulationRunning = ResumeSimulation(&simulation, table);
+
+            if (reloadChanges & RELOAD_BACKGROUND) {
+                if (background.id != 0) UnloadTexture(background);
+                Image backgroundImage = LoadTableBackground(assets);
+                background = backgroundImage.data != NULL ? LoadTextureFromImage(backgroundImage) : (Texture2D){0};
+                if (backgroundImage.data != NULL) UnloadImage(backgroundImage);
+            }
+            if (reloadChanges & RELOAD_SPRITES) {
+                UnloadSpriteAtlas(&planetAtlas);
+                BuildPlanetAtlas(table, assets, &planetAtlas);
+            }
+            if (reloadChanges & (RELOAD_TABLE | RELOAD_BACKGROUND | RELOAD_SPRITES)) {
+                BuildStaticLayer(&staticLayer, table, background, &planetAtlas, renderScale);
+            }
+            TraceLog(LOG_INFO, "RELOAD:%s%s%s%s in %.1f ms", (reloadChanges & RELOAD_TABLE) ? " table" : "",
+                     (reloadChanges & RELOAD_BACKGROUND) ? " background" : "", (reloadChanges & RELOAD_SOUND) ? " sound" : "",
+                     (reloadChanges & RELOAD_SPRITES) ? " sprites" : "", (TimerNowSeconds() - reloadStart) * 1000.0);
+        }
+
+        // Going idle switches to attract playback when there is one; any input
+        // brings the live game back before this frame is drawn.
+        if (!idle && !replaying && !spectating && TimerNowSeconds() - inputSampler.lastInputTime > idleSeconds) {
+            idle = true;
+            if (attract.loaded) {
+                StopSimulation(&simulation);
+                attract.active = StartAttractPlayback(&attract, &simulation, &collisionEvents);
+                if (!attract.active) attract.loaded = false;
+                simulationRunning = attract.active;
+            }
+        } else if (idle && (inputActive || (attract.active && AcquireSnapshot(&simulation)->replayFinished))) {
+            // Either a player arrived or the attract replay ended and loops.
+            idle = !inputActive;
+            if (attract.active) {
+                StopSimulation(&simulation);
+                attract.active = idle && StartAttractPlayback(&attract, &simulation, &collisionEvents);
+                simulationRunning = attract.active;
+            }
+            if (!simulationRunning) {
+                ResetGameState(table, &state);
+                inputSampler.sentMask = 0;
+                simulationRunning = StartSimulation(&simulation, table, &state, &collisionEvents, &replay, &replayCursor,
+                                                    false, false, 1, liveStepOutput, NULL);
+            }
+        }
+        if (!simulationRunning && !spectating) {
+            TraceLog(LOG_ERROR, "SIM: cannot start the simulation thread");
+            break;
+        }
+        const Table *simulationTable = attract.active ? &attract.table : table;
+
+        // Render one step behind the sim clock, between the last two states.
+        // Spectators render between received steps instead.
+        const SimSnapshot *snapshot;
+        float interpolationAlpha;
+        if (spectating) {
+            UpdateNetClient(&spectator, TimerNowSeconds());
+            interpolationAlpha = NetClientSnapshot(&spectator, table, TimerNowSeconds(), &spectatorSnapshot);
+            snapshot = &spectatorSnapshot;
+        } else {
+            snapshot = AcquireSnapshot(&simulation);
+            int playbackSpeed = attract.active ? 1 : replaySpeed;
+            interpolationAlpha = (float)((TimerNowSeconds() - snapshot->stepEndTime) * playbackSpeed /
+                                         simulationTable->physics.fixedDeltaTime);
+            if (interpolationAlpha < 0.0f) interpolationAlpha = 0.0f;
+            if (interpolationAlpha > 1.0f) interpolationAlpha = 1.0f;
+        }
+        if (versus) UpdateNetClient(&opponentClient, TimerNowSeconds());
+
+        if (snapshot->replayFinished && !replayReported) {
+            TraceLog(LOG_INFO, "REPLAY: finished, final state %s", snapshot->replayMatched ? "matches" : "DIFFERS");
+            replayReported = true;
+        }
+
+        double frameTime = TimerNowSeconds();
+        UpdateParticles(&particles, (float)(frameTime - lastFrameTime));
+        TallyFrame(&gameFrames, frameTime - lastFrameTime, frameBudget * SLOW_FRAME_FACTOR);
+        TallyFrame(&sessionFrames, frameTime - lastFrameTime, frameBudget * SLOW_FRAME_FACTOR);
+        lastFrameTime = frameTime;
+
+        // Results of the attract loop are drained and thrown away.
+        GameResult gameResult;
+        while (simulationRunning && PopGameResult(&simulation.gameResults, &gameResult)) {
+            if (!keepingScores || attract.active) continue;
+            FrameSummary frameSummary = SummariseFrames(&gameFrames);
+            SubmitGameResult(&scores, table, &gameResult, &frameSummary);
+            memset(&gameFrames, 0, sizeof(gameFrames));
+            gamesPlayed++;
+        }
+
+        // Drawing reuses the poses cached by the step, so no trig runs per frame.
+        FlipperPose renderFlipperPoses[MAX_FLIPPERS];
+        for (int i = 0; i < table->flipperCount; i++) {
+            renderFlipperPoses[i] = InterpolateFlipperPose(&table->flippers[i], &snapshot->previousFlipperPoses[i],
+                                                           &snapshot->flipperPoses[i], interpolationAlpha);
+        }
+
+        PROFILE_BEGIN(PROFILE_DRAW);
+        BeginRenderView(&renderView);
+        ClearBackground(BLACK);
+        DrawStaticLayer(&staticLayer);
+
+        for (int i = 0; i < table->flipperCount; i++) DrawFlipper(&table->flippers[i], &renderFlipperPoses[i], LIGHTGRAY);
+
+        for (int i = 0; i < snapshot->ballCount; i++) {
+            float renderX = snapshot->previousX[i] + (snapshot->x[i] - snapshot->previousX[i]) * interpolationAlpha;
+            float renderY = snapshot->previousY[i] + (snapshot->y[i] - snapshot->previousY[i]) * interpolationAlpha;
+            DrawCircleV((Vector2){renderX, renderY}, snapshot->radius[i], WHITE);
+        }
+        DrawParticles(&particles);
+        
+        DrawText(TextFormat("Score: %d", snapshot->score), 10, 10, 24, RAYWHITE);
+        if (keepingScores) {
+            const char *bestText = TextFormat("Best: %d", scores.bestScore > snapshot->score ? scores.bestScore : snapshot->score);
+            DrawText(bestText, (int)table->width - MeasureText(bestText, 24) - 10, 10, 24, RAYWHITE);
+        }
+        if (attract.active) {
+            DrawText("PRESS ANY KEY TO PLAY", (int)table->width / 2 - MeasureText("PRESS ANY KEY TO PLAY", 24) / 2,
+                     (int)table->height / 3, 24, YELLOW);
+        } else if (replaying) {
+            const char *replayStatus = !snapshot->replayFinished ? TextFormat("REPLAY x%d", replaySpeed) :
+                                       snapshot->replayMatched ? "REPLAY END: MATCH" : "REPLAY END: MISMATCH";
+            DrawText(replayStatus, 10, 40, 20, YELLOW);
+        } else if (spectating) {
+            const char *spectateStatus = spectator.rejected ? "SPECTATE: TABLE DIFFERS FROM HOST" :
+                                         !spectator.welcomed ? "SPECTATE: CONNECTING" : "SPECTATING";
+            DrawText(spectateStatus, 10, 40, 20, YELLOW);
+        }
+        if (versus) {
+            const char *opponentStatus = opponentClient.rejected ? "Opponent: table differs" :
+                                         !opponentClient.welcomed ? "Opponent: connecting" :
+                                         TextFormat("Opponent: %d", AcquireSnapshot(&opponent)->score);
+            DrawText(opponentStatus, 10, 64, 20, ORANGE);
+        }
+        
+#if defined(PINBALL_PROFILE)
+        if (inputSampler.showProfiler) DrawProfilerOverlay(&activeProfiler, (int)table->width);
+#endif
+        EndRenderView();
+        PROFILE_END(PROFILE_DRAW);
+
+        PROFILE_BEGIN(PROFILE_PRESENT);
+        BeginDrawing();
+        ClearBackground(BLACK);
+        PresentRenderView(&renderView, GetScreenWidth(), GetScreenHeight());
+        EndDrawing();
+        PROFILE_END(PROFILE_PRESENT);
+
+        // Idle cabinets and still tables draw and poll less often. Input during
+        // the wait ends it, so the next frame is already at full rate.
+        bool slow = idle || (snapshot->atRest && particles.count == 0);
+        double frameSeconds = slow ? IDLE_FRAME_SECONDS : TARGET_FRAME_SECONDS;
+        double pollSeconds = slow ? IDLE_POLL_SECONDS : INPUT_POLL_SECONDS;
+        for (double remaining = nextFrameTime - TimerNowSeconds(); remaining > 0.0; remaining = nextFrameTime - TimerNowSeconds()) {
+            WaitTime(remaining < pollSeconds ? remaining : pollSeconds);
+            PollInputEvents();
+            if (SampleInput(&simulation, &inputSampler) && slow) break;
+        }
+        frameBudget = frameSeconds;
+        nextFrameTime += frameSeconds;
+        if (nextFrameTime < TimerNowSeconds()) nextFrameTime = TimerNowSeconds() + frameSeconds;
+#if defined(PINBALL_PROFILE)
+        AbsorbSimulationProfile(&simulation, &activeProfiler);
+        ProfilerEndFrame(&activeProfiler);
+#endif
+    }
+
+    if (simulationRunning) StopSimulation(&simulation);
+    if (versus) {
+        StopSimulation(&opponent);
+        StopNetClient(&opponentClient);
+    }
+    if (spectating) StopNetClient(&spectator);
+    if (keepingScores) {
+        FrameSummary sessionSummary = SummariseFrames(&sessionFrames);
+        SubmitSessionSummary(&scores, sessionStartTime, gamesPlayed, &sessionSummary);
+        CloseScoreStore(&scores);
+        TraceLog(LOG_INFO, "SCORES: %u games this session, best %d, %u records dropped", gamesPlayed, scores.bestScore, scores.dropped);
+    }
+    if (hosting) {
+        StopNetHost(&netHost);
+        TraceLog(LOG_INFO, "NET: sent %llu packets, %llu bytes, peak %d viewers, %u steps dropped",
+                 netHost.packetsSent, netHost.bytesSent, netHost.peakViewers, netHost.steps.dropped);
+    }
+    if (attract.loaded) FreeReplay(&attract.replay);
+    UnloadParticleSystem(&particles);
+    UnloadStaticLayer(&staticLayer);
+    UnloadRenderView(&renderView);
+    if (background.id != 0) UnloadTexture(background);
+    UnloadSpriteAtlas(&planetAtlas);
+    
+    UnloadAudioMixer(&audioMixer);
+    if (replaying) {
+        FreeReplay(&replay);
+    } else if (recordPath && !spectating) {
+        FinishReplayRecording(&replay, &state);
+        if (!SaveReplay(recordPath, &replay)) TraceLog(LOG_WARNING, "REPLAY: cannot write %s", recordPath);
+        FreeReplay(&replay);
+    }
+#if defined(PINBALL_PROFILE)
+    ProfilerCloseCsv(&activeProfiler);
+#endif
+    TraceLog(LOG_INFO, "MEMORY: session arena peak %zu of %zu bytes, peak balls %d of %d, peak queued events %u of %d (%u dropped)",
+             sessionArena.highWater, sessionArena.capacity, state.balls.peakCount, state.balls.capacity,
+             collisionEvents.peakFill, EVENT_QUEUE_CAPACITY, collisionEvents.dropped);
+    TraceLog(LOG_INFO, "MEMORY: peak particles %d of %d", particles.peakCount, particles.capacity);
+    FreeArena(&sessionArena);
+    CloseTableFile(&tableFile);
+    CloseAudioDevice();
+    CloseWindow();
+    return 0;
+
+}
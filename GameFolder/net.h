@@ -0,0 +1,868 @@
+#ifndef PINBALL_NET_H
+#define PINBALL_NET_H
+
+#include "physics.h"
+#include "replay.h"
+#include "sim.h"
+#include "thread.h"
+#include "timer.h"
+#include <math.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Streams a running game over UDP. The host copies every finished step out of
+// the sim (see StepRecordRing) and a network thread fans it out to viewers,
+// which pick one of two streams when they say hello:
+//
+// State viewers get a packet every few steps, about 60 a second whatever the
+// step rate, with the score, ball positions and flipper angles quantised to
+// integers and delta-coded against the newest step the viewer acknowledged.
+// The step goes out as a varint and that baseline as its distance back from
+// it, 0 for a keyframe. Acks go out ten times a second and double as
+// keepalives; a viewer without a usable baseline gets a keyframe instead.
+// Viewers that share a baseline share the encoded packet, so the per-viewer
+// cost of a packet is one sendto. The viewer draws a little over one packet
+// behind the host clock, between the two received steps around that time.
+//
+// Input viewers get the flipper masks instead, two bits per step, resent at
+// the same pace from the first step the viewer has not acknowledged. Fed into
+// a lockstep sim on the same table, they reproduce the host's game exactly,
+// like a replay. Only games started from a reset table can be followed this
+// way.
+//
+// Win32 entry points are declared by hand, like in timer.h and thread.h, so
+// this header can sit next to raylib.h; Windows builds link ws2_32. Addresses
+// are IPv4 only.
+
+#define NET_PROTOCOL_VERSION 3
+#define NET_MAX_PACKET 1200
+#define NET_MAX_VIEWERS 256
+#define NET_HISTORY 64
+#define NET_ENCODE_CACHE 8
+#define NET_INPUT_BATCH 2048
+#define NET_INPUT_BITS 2
+#define NET_ACK_SECONDS 0.1
+#define NET_HELLO_SECONDS 0.5
+#define NET_VIEWER_TIMEOUT_SECONDS 5.0
+#define NET_POLL_SECONDS 0.001
+#define NET_POSITION_SCALE 32.0f
+#define NET_ANGLE_SCALE 4096.0f
+#define NET_SEND_RATE 60.0f
+#define NET_INTERPOLATION_DELAY_STEPS 3.0
+#define NET_CLOCK_SNAP_STEPS 30.0
+#define NET_CLOCK_SMOOTHING 0.05
+#define NET_NO_BASELINE 0xFFFFFFFFu
+
+// Score, ball count, one angle per flipper and x, y, radius per ball.
+#define NET_STATE_FIELDS (2 + MAX_FLIPPERS + 3 * SIM_MAX_SNAPSHOT_BALLS)
+#if NET_STATE_FIELDS > 64
+#error "the state delta mask covers at most 64 fields"
+#endif
+
+enum {
+    NET_PACKET_HELLO = 1,
+    NET_PACKET_WELCOME = 2,
+    NET_PACKET_STATE = 3,
+    NET_PACKET_INPUTS = 4,
+    NET_PACKET_ACK = 5,
+    NET_PACKET_BYE = 6
+};
+
+enum {
+    NET_MODE_STATE = 0,
+    NET_MODE_INPUT = 1
+};
+
+// Host byte order.
+typedef struct {
+    uint32_t host;
+    uint16_t port;
+} NetAddress;
+
+#if defined(_WIN32)
+typedef uintptr_t NetSocket;
+#define NET_INVALID_SOCKET (~(uintptr_t)0)
+
+typedef struct {
+    uint16_t family;
+    uint16_t port;
+    uint32_t address;
+    char zero[8];
+} NetSocketAddress;
+
+__declspec(dllimport) int __stdcall WSAStartup(unsigned short version, void *data);
+__declspec(dllimport) int __stdcall WSACleanup(void);
+__declspec(dllimport) uintptr_t __stdcall socket(int family, int type, int protocol);
+__declspec(dllimport) int __stdcall bind(uintptr_t socket, const void *address, int addressSize);
+__declspec(dllimport) int __stdcall sendto(uintptr_t socket, const char *data, int size, int flags,
+                                           const void *address, int addressSize);
+__declspec(dllimport) int __stdcall recvfrom(uintptr_t socket, char *data, int size, int flags,
+                                             void *address, int *addressSize);
+__declspec(dllimport) int __stdcall closesocket(uintptr_t socket);
+__declspec(dllimport) int __stdcall ioctlsocket(uintptr_t socket, long command, unsigned long *argument);
+
+// Windows only runs on little-endian targets.
+static inline uint16_t NetToNetwork16(uint16_t value) { return (uint16_t)(value << 8 | value >> 8); }
+static inline uint32_t NetToNetwork32(uint32_t value) {
+    return value << 24 | (value & 0xFF00u) << 8 | (value >> 8 & 0xFF00u) | value >> 24;
+}
+
+static inline bool NetStartup(void) {
+    unsigned char data[512];
+    return WSAStartup(0x0202, data) == 0;
+}
+
+static inline void NetCleanup(void) {
+    WSACleanup();
+}
+
+static inline bool NetSetNonBlocking(NetSocket handle) {
+    unsigned long enabled = 1;
+    return ioctlsocket(handle, (long)0x8004667Eul, &enabled) == 0;
+}
+
+static inline void NetCloseSocket(NetSocket handle) {
+    closesocket(handle);
+}
+#else
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+typedef int NetSocket;
+#define NET_INVALID_SOCKET (-1)
+typedef struct sockaddr_in NetSocketAddress;
+
+static inline uint16_t NetToNetwork16(uint16_t value) { return htons(value); }
+static inline uint32_t NetToNetwork32(uint32_t value) { return htonl(value); }
+
+static inline bool NetStartup(void) {
+    return true;
+}
+
+static inline void NetCleanup(void) {
+}
+
+static inline bool NetSetNonBlocking(NetSocket handle) {
+    int flags = fcntl(handle, F_GETFL, 0);
+    return flags >= 0 && fcntl(handle, F_SETFL, flags | O_NONBLOCK) == 0;
+}
+
+static inline void NetCloseSocket(NetSocket handle) {
+    close(handle);
+}
+#endif
+
+static inline NetSocketAddress NetMakeSocketAddress(NetAddress address) {
+    NetSocketAddress socketAddress;
+    memset(&socketAddress, 0, sizeof(socketAddress));
+#if defined(_WIN32)
+    socketAddress.family = 2;
+    socketAddress.port = NetToNetwork16(address.port);
+    socketAddress.address = NetToNetwork32(address.host);
+#else
+    socketAddress.sin_family = AF_INET;
+    socketAddress.sin_port = NetToNetwork16(address.port);
+    socketAddress.sin_addr.s_addr = NetToNetwork32(address.host);
+#endif
+    return socketAddress;
+}
+
+static inline NetAddress NetReadSocketAddress(const NetSocketAddress *socketAddress) {
+#if defined(_WIN32)
+    return (NetAddress){NetToNetwork32(socketAddress->address), NetToNetwork16(socketAddress->port)};
+#else
+    return (NetAddress){ntohl(socketAddress->sin_addr.s_addr), ntohs(socketAddress->sin_port)};
+#endif
+}
+
+// Binds a non-blocking UDP socket to the given port on every interface; port
+// 0 picks a free one.
+static inline bool NetOpenSocket(uint16_t port, NetSocket *result) {
+#if defined(_WIN32)
+    NetSocket handle = socket(2, 2, 17);
+#else
+    NetSocket handle = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+#endif
+    if (handle == NET_INVALID_SOCKET) return false;
+    NetSocketAddress socketAddress = NetMakeSocketAddress((NetAddress){0, port});
+    if (bind(handle, (const void *)&socketAddress, (int)sizeof(socketAddress)) != 0 || !NetSetNonBlocking(handle)) {
+        NetCloseSocket(handle);
+        return false;
+    }
+    *result = handle;
+    return true;
+}
+
+static inline bool NetSend(NetSocket handle, NetAddress address, const uint8_t *data, int size) {
+    NetSocketAddress socketAddress = NetMakeSocketAddress(address);
+    return sendto(handle, (const char *)data, size, 0, (const void *)&socketAddress, (int)sizeof(socketAddress)) == size;
+}
+
+// Returns the size of the next waiting datagram, or 0 when there is none.
+static inline int NetReceive(NetSocket handle, NetAddress *from, uint8_t *buffer, int capacity) {
+    NetSocketAddress socketAddress;
+#if defined(_WIN32)
+    int addressSize = (int)sizeof(socketAddress);
+#else
+    socklen_t addressSize = sizeof(socketAddress);
+#endif
+    int size = (int)recvfrom(handle, (char *)buffer, capacity, 0, (void *)&socketAddress, &addressSize);
+    if (size <= 0) return 0;
+    *from = NetReadSocketAddress(&socketAddress);
+    return size;
+}
+
+// Accepts "a.b.c.d:port" and "localhost:port".
+static inline bool NetParseAddress(const char *text, NetAddress *address) {
+    unsigned int a, b, c, d, port;
+    char trailing;
+    if (sscanf(text, "localhost:%u%c", &port, &trailing) == 1) {
+        a = 127, b = 0, c = 0, d = 1;
+    } else if (sscanf(text, "%u.%u.%u.%u:%u%c", &a, &b, &c, &d, &port, &trailing) != 5) {
+        return false;
+    }
+    if (a > 255 || b > 255 || c > 255 || d > 255 || port == 0 || port > 65535) return false;
+    address->host = a << 24 | b << 16 | c << 8 | d;
+    address->port = (uint16_t)port;
+    return true;
+}
+
+static inline bool NetSameAddress(NetAddress a, NetAddress b) {
+    return a.host == b.host && a.port == b.port;
+}
+
+// Little-endian packet writer and reader. Overruns set a flag instead of
+// writing or reading past the buffer.
+typedef struct {
+    uint8_t *data;
+    int capacity;
+    int size;
+    bool failed;
+} NetWriter;
+
+typedef struct {
+    const uint8_t *data;
+    int size;
+    int offset;
+    bool failed;
+} NetReader;
+
+static inline void NetWriteU8(NetWriter *writer, uint32_t value) {
+    if (writer->size >= writer->capacity) {
+        writer->failed = true;
+        return;
+    }
+    writer->data[writer->size++] = (uint8_t)value;
+}
+
+static inline void NetWriteU16(NetWriter *writer, uint32_t value) {
+    NetWriteU8(writer, value);
+    NetWriteU8(writer, value >> 8);
+}
+
+static inline void NetWriteU32(NetWriter *writer, uint32_t value) {
+    NetWriteU16(writer, value);
+    NetWriteU16(writer, value >> 16);
+}
+
+static inline void NetWriteVarint(NetWriter *writer, uint32_t value) {
+    while (value >= 0x80u) {
+        NetWriteU8(writer, value | 0x80u);
+        value >>= 7;
+    }
+    NetWriteU8(writer, value);
+}
+
+static inline uint32_t NetReadU8(NetReader *reader) {
+    if (reader->offset >= reader->size) {
+        reader->failed = true;
+        return 0;
+    }
+    return reader->data[reader->offset++];
+}
+
+static inline uint32_t NetReadU16(NetReader *reader) {
+    uint32_t low = NetReadU8(reader);
+    return low | NetReadU8(reader) << 8;
+}
+
+static inline uint32_t NetReadU32(NetReader *reader) {
+    uint32_t low = NetReadU16(reader);
+    return low | NetReadU16(reader) << 16;
+}
+
+static inline uint32_t NetReadVarint(NetReader *reader) {
+    uint32_t value = 0;
+    for (int shift = 0; shift < 35; shift += 7) {
+        uint32_t byte = NetReadU8(reader);
+        value |= (byte & 0x7Fu) << shift;
+        if ((byte & 0x80u) == 0) return value;
+    }
+    reader->failed = true;
+    return 0;
+}
+
+static inline uint32_t NetZigZag(int32_t value) {
+    return (uint32_t)value << 1 ^ (uint32_t)(value >> 31);
+}
+
+static inline int32_t NetUnZigZag(uint32_t value) {
+    return (int32_t)(value >> 1 ^ (0u - (value & 1u)));
+}
+
+static inline void NetWriteHeader(NetWriter *writer, uint32_t type, uint32_t session) {
+    NetWriteU8(writer, 'P');
+    NetWriteU8(writer, 'B');
+    NetWriteU8(writer, NET_PROTOCOL_VERSION);
+    NetWriteU8(writer, type);
+    NetWriteU32(writer, session);
+}
+
+static inline bool NetReadHeader(NetReader *reader, uint32_t *type, uint32_t *session) {
+    bool ok = NetReadU8(reader) == 'P' && NetReadU8(reader) == 'B' && NetReadU8(reader) == NET_PROTOCOL_VERSION;
+    *type = NetReadU8(reader);
+    *session = NetReadU32(reader);
+    return ok && !reader->failed;
+}
+
+// Steps between two packets to a viewer. Both ends derive it from the step
+// rate, which the table signature already pins down.
+static inline uint32_t NetSendInterval(const Table *table) {
+    long interval = lrintf(1.0f / (table->physics.fixedDeltaTime * NET_SEND_RATE));
+    return interval > 1 ? (uint32_t)interval : 1u;
+}
+
+// Only steps that go out are kept, so the history spans NET_HISTORY packets.
+static inline uint32_t NetHistorySlot(uint32_t step, uint32_t sendInterval) {
+    return step / sendInterval % NET_HISTORY;
+}
+
+// Both ends must agree on the table and the step settings.
+static inline uint32_t NetTableSignature(const Table *table) {
+    uint32_t continuous = table->physics.continuousCollision ? 1u : 0u;
+    uint32_t hash = TableHash(table);
+    hash = HashBytes(hash, &table->physics.fixedDeltaTime, sizeof(float));
+    hash = HashBytes(hash, &continuous, sizeof(continuous));
+    hash = HashBytes(hash, &table->multiballJackpotScore, sizeof(int));
+    return hash;
+}
+
+typedef struct {
+    uint32_t step;
+    int32_t fields[NET_STATE_FIELDS];
+} NetStateFrame;
+
+static inline int32_t NetQuantise(float value, float scale) {
+    return (int32_t)lrintf(value * scale);
+}
+
+static inline void QuantiseStepRecord(const StepRecord *record, int flipperCount, NetStateFrame *frame) {
+    memset(frame->fields, 0, sizeof(frame->fields));
+    frame->step = (uint32_t)record->step;
+    frame->fields[0] = record->score;
+    frame->fields[1] = record->ballCount;
+    for (int i = 0; i < flipperCount; i++) frame->fields[2 + i] = NetQuantise(record->flipperAngles[i], NET_ANGLE_SCALE);
+    int32_t *ballFields = frame->fields + 2 + MAX_FLIPPERS;
+    for (int i = 0; i < record->ballCount; i++) {
+        ballFields[i * 3] = NetQuantise(record->x[i], NET_POSITION_SCALE);
+        ballFields[i * 3 + 1] = NetQuantise(record->y[i], NET_POSITION_SCALE);
+        ballFields[i * 3 + 2] = NetQuantise(record->radius[i], NET_POSITION_SCALE);
+    }
+}
+
+// A byte naming the groups of eight fields that changed, a change mask per
+// such group, then the zigzag varint delta of every changed field. Fields
+// that did not move cost nothing; a keyframe is a delta against zeros.
+static inline void WriteStateDelta(NetWriter *writer, const int32_t *fields, const int32_t *baseline) {
+    uint64_t changed = 0;
+    for (int i = 0; i < NET_STATE_FIELDS; i++) {
+        if (fields[i] != (baseline ? baseline[i] : 0)) changed |= 1ull << i;
+    }
+    uint32_t groups = 0;
+    for (int group = 0; group < 8; group++) {
+        if ((changed >> (group * 8)) & 0xFFu) groups |= 1u << group;
+    }
+    NetWriteU8(writer, groups);
+    for (int group = 0; group < 8; group++) {
+        if (groups & (1u << group)) NetWriteU8(writer, (uint32_t)(changed >> (group * 8)) & 0xFFu);
+    }
+    for (int i = 0; i < NET_STATE_FIELDS; i++) {
+        if (!(changed & (1ull << i))) continue;
+        int32_t base = baseline ? baseline[i] : 0;
+        NetWriteVarint(writer, NetZigZag((int32_t)((uint32_t)fields[i] - (uint32_t)base)));
+    }
+}
+
+static inline bool ReadStateDelta(NetReader *reader, const int32_t *baseline, int32_t *fields) {
+    uint32_t groups = NetReadU8(reader);
+    uint64_t changed = 0;
+    for (int group = 0; group < 8; group++) {
+        if (groups & (1u << group)) changed |= (uint64_t)NetReadU8(reader) << (group * 8);
+    }
+    if (changed >> NET_STATE_FIELDS) return false;
+    for (int i = 0; i < NET_STATE_FIELDS; i++) {
+        int32_t base = baseline ? baseline[i] : 0;
+        fields[i] = (changed & (1ull << i)) ? (int32_t)((uint32_t)base + (uint32_t)NetUnZigZag(NetReadVarint(reader))) : base;
+    }
+    return !reader->failed && fields[1] >= 0 && fields[1] <= SIM_MAX_SNAPSHOT_BALLS;
+}
+
+// Host side. Every member below the ring belongs to the network thread.
+typedef struct {
+    NetAddress address;
+    int mode;
+    // State viewers: newest step decoded. Input viewers: every mask up to this
+    // step has arrived.
+    uint32_t ackStep;
+    double lastHeard;
+    bool active;
+} NetViewer;
+
+typedef struct {
+    uint32_t baseline;
+    int size;
+    uint8_t bytes[NET_MAX_PACKET];
+} NetEncodedState;
+
+typedef struct {
+    StepRecordRing steps;
+
+    NetSocket socket;
+    uint32_t session;
+    uint32_t tableSignature;
+    uint32_t sendInterval;
+    int flipperCount;
+    NetViewer viewers[NET_MAX_VIEWERS];
+    int viewerCount;
+    int peakViewers;
+    NetStateFrame history[NET_HISTORY];
+    uint32_t latestStep;
+    // Two bits per step from step 1 on, four steps to a byte.
+    uint8_t *inputLog;
+    uint32_t inputLogBytes;
+    uint32_t inputSteps;
+    bool inputGap;
+    NetEncodedState encoded[NET_ENCODE_CACHE];
+    int encodedCount;
+    unsigned long long packetsSent;
+    unsigned long long bytesSent;
+
+    atomic_bool quit;
+    Thread thread;
+} NetHost;
+
+static inline void HostSend(NetHost *host, NetAddress address, const uint8_t *data, int size) {
+    if (!NetSend(host->socket, address, data, size)) return;
+    host->packetsSent++;
+    host->bytesSent += (unsigned long long)size;
+}
+
+static inline NetViewer *FindViewer(NetHost *host, NetAddress address) {
+    for (int i = 0; i < NET_MAX_VIEWERS; i++) {
+        if (host->viewers[i].active && NetSameAddress(host->viewers[i].address, address)) return &host->viewers[i];
+    }
+    return NULL;
+}
+
+static inline NetViewer *AddViewer(NetHost *host, NetAddress address) {
+    for (int i = 0; i < NET_MAX_VIEWERS; i++) {
+        NetViewer *viewer = &host->viewers[i];
+        if (viewer->active) continue;
+        memset(viewer, 0, sizeof(*viewer));
+        viewer->address = address;
+        viewer->active = true;
+        if (++host->viewerCount > host->peakViewers) host->peakViewers = host->viewerCount;
+        return viewer;
+    }
+    return NULL;
+}
+
+static inline void RemoveViewer(NetHost *host, NetViewer *viewer) {
+    viewer->active = false;
+    host->viewerCount--;
+}
+
+static inline void HandleHostPacket(NetHost *host, NetAddress from, const uint8_t *data, int size, double now) {
+    NetReader reader = {data, size, 0, false};
+    uint32_t type, session;
+    if (!NetReadHeader(&reader, &type, &session)) return;
+    NetViewer *viewer = FindViewer(host, from);
+
+    if (type == NET_PACKET_HELLO) {
+        uint32_t mode = NetReadU8(&reader);
+        uint32_t signature = NetReadU32(&reader);
+        bool accepted = !reader.failed && signature == host->tableSignature &&
+                        (mode == NET_MODE_STATE || mode == NET_MODE_INPUT);
+        if (accepted && !viewer) viewer = AddViewer(host, from);
+        accepted = accepted && viewer;
+        if (accepted) {
+            viewer->mode = (int)mode;
+            viewer->ackStep = 0;
+            viewer->lastHeard = now;
+        }
+        uint8_t bytes[32];
+        NetWriter writer = {bytes, sizeof(bytes), 0, false};
+        NetWriteHeader(&writer, NET_PACKET_WELCOME, host->session);
+        NetWriteU8(&writer, accepted ? 1u : 0u);
+        NetWriteU32(&writer, host->tableSignature);
+        HostSend(host, from, bytes, writer.size);
+        return;
+    }
+    if (!viewer || session != host->session) return;
+    if (type == NET_PACKET_ACK) {
+        uint32_t step = NetReadU32(&reader);
+        if (!reader.failed && step > viewer->ackStep && step <= host->latestStep) viewer->ackStep = step;
+        viewer->lastHeard = now;
+    } else if (type == NET_PACKET_BYE) {
+        RemoveViewer(host, viewer);
+    }
+}
+
+static inline void AppendHostInput(NetHost *host, uint32_t step, unsigned int inputMask) {
+    if (host->inputGap) return;
+    if (step != host->inputSteps + 1) {
+        // A dropped record leaves a hole no input viewer can get past.
+        host->inputGap = true;
+        return;
+    }
+    uint32_t byte = host->inputSteps / 4;
+    if (byte >= host->inputLogBytes) {
+        uint32_t bytes = host->inputLogBytes ? host->inputLogBytes * 2 : 4096;
+        uint8_t *log = (uint8_t *)realloc(host->inputLog, bytes);
+        if (!log) {
+            host->inputGap = true;
+            return;
+        }
+        memset(log + host->inputLogBytes, 0, bytes - host->inputLogBytes);
+        host->inputLog = log;
+        host->inputLogBytes = bytes;
+    }
+    host->inputLog[byte] |= (uint8_t)((inputMask & 3u) << (host->inputSteps % 4 * NET_INPUT_BITS));
+    host->inputSteps++;
+}
+
+static inline unsigned int HostInputAt(const NetHost *host, uint32_t step) {
+    uint32_t index = step - 1;
+    return (host->inputLog[index / 4] >> (index % 4 * NET_INPUT_BITS)) & 3u;
+}
+
+static inline void SendStateToViewer(NetHost *host, const NetViewer *viewer, const NetStateFrame *frame) {
+    uint32_t baseline = viewer->ackStep;
+    const NetStateFrame *base = &host->history[NetHistorySlot(baseline, host->sendInterval)];
+    if (baseline == 0 || baseline >= frame->step || base->step != baseline) baseline = NET_NO_BASELINE;
+
+    NetEncodedState *encoded = NULL;
+    for (int i = 0; i < host->encodedCount && !encoded; i++) {
+        if (host->encoded[i].baseline == baseline) encoded = &host->encoded[i];
+    }
+    if (!encoded) {
+        // Past the cache size the last entry is recycled.
+        encoded = &host->encoded[host->encodedCount < NET_ENCODE_CACHE ? host->encodedCount++ : NET_ENCODE_CACHE - 1];
+        NetWriter writer = {encoded->bytes, NET_MAX_PACKET, 0, false};
+        NetWriteHeader(&writer, NET_PACKET_STATE, host->session);
+        NetWriteVarint(&writer, frame->step);
+        NetWriteVarint(&writer, baseline == NET_NO_BASELINE ? 0 : frame->step - baseline);
+        WriteStateDelta(&writer, frame->fields, baseline == NET_NO_BASELINE ? NULL : base->fields);
+        encoded->baseline = baseline;
+        encoded->size = writer.failed ? 0 : writer.size;
+    }
+    if (encoded->size > 0) HostSend(host, viewer->address, encoded->bytes, encoded->size);
+}
+
+static inline void SendInputsToViewer(NetHost *host, const NetViewer *viewer) {
+    uint32_t first = viewer->ackStep + 1;
+    if (first > host->inputSteps) return;
+    uint32_t count = host->inputSteps - first + 1;
+    if (count > NET_INPUT_BATCH) count = NET_INPUT_BATCH;
+
+    uint8_t bytes[16 + NET_INPUT_BATCH / 4];
+    NetWriter writer = {bytes, sizeof(bytes), 0, false};
+    NetWriteHeader(&writer, NET_PACKET_INPUTS, host->session);
+    NetWriteU32(&writer, first);
+    NetWriteU16(&writer, count);
+    for (uint32_t i = 0; i < count; i += 4) {
+        uint32_t packed = 0;
+        for (uint32_t j = i; j < count && j < i + 4; j++) packed |= HostInputAt(host, first + j) << ((j - i) * NET_INPUT_BITS);
+        NetWriteU8(&writer, packed);
+    }
+    HostSend(host, viewer->address, bytes, writer.size);
+}
+
+static inline void HostRecordStep(NetHost *host, const StepRecord *record, double now) {
+    host->latestStep = (uint32_t)record->step;
+    AppendHostInput(host, host->latestStep, record->inputMask);
+    if (host->latestStep % host->sendInterval != 0) return;
+    NetStateFrame *frame = &host->history[NetHistorySlot(host->latestStep, host->sendInterval)];
+    QuantiseStepRecord(record, host->flipperCount, frame);
+
+    host->encodedCount = 0;
+    for (int i = 0; i < NET_MAX_VIEWERS; i++) {
+        NetViewer *viewer = &host->viewers[i];
+        if (!viewer->active) continue;
+        if (now - viewer->lastHeard > NET_VIEWER_TIMEOUT_SECONDS) {
+            RemoveViewer(host, viewer);
+        } else if (viewer->mode == NET_MODE_STATE) {
+            SendStateToViewer(host, viewer, frame);
+        } else if (!host->inputGap) {
+            SendInputsToViewer(host, viewer);
+        }
+    }
+}
+
+static inline int NetHostThreadMain(void *argument) {
+    NetHost *host = (NetHost *)argument;
+    uint8_t buffer[NET_MAX_PACKET];
+    while (!atomic_load(&host->quit)) {
+        double now = TimerNowSeconds();
+        NetAddress from;
+        int size;
+        while ((size = NetReceive(host->socket, &from, buffer, sizeof(buffer))) > 0) HandleHostPacket(host, from, buffer, size, now);
+        StepRecord record;
+        while (PopStepRecord(&host->steps, &record)) HostRecordStep(host, &record, now);
+        ThreadSleepSeconds(NET_POLL_SECONDS);
+    }
+    return 0;
+}
+
+// The sim is pointed at host->steps once this returns true.
+static inline bool StartNetHost(NetHost *host, const Table *table, uint16_t port) {
+    memset(host, 0, sizeof(*host));
+    InitStepRecordRing(&host->steps);
+    atomic_init(&host->quit, false);
+    host->tableSignature = NetTableSignature(table);
+    host->sendInterval = NetSendInterval(table);
+    host->flipperCount = table->flipperCount;
+    host->session = (uint32_t)(TimerNowSeconds() * 1000.0) ^ host->tableSignature;
+    for (int i = 0; i < NET_HISTORY; i++) host->history[i].step = NET_NO_BASELINE;
+
+    if (!NetStartup()) return false;
+    if (!NetOpenSocket(port, &host->socket)) {
+        NetCleanup();
+        return false;
+    }
+    if (!ThreadStart(&host->thread, NetHostThreadMain, host)) {
+        NetCloseSocket(host->socket);
+        NetCleanup();
+        return false;
+    }
+    return true;
+}
+
+static inline void StopNetHost(NetHost *host) {
+    atomic_store(&host->quit, true);
+    ThreadJoin(host->thread);
+    NetCloseSocket(host->socket);
+    NetCleanup();
+    free(host->inputLog);
+    host->inputLog = NULL;
+}
+
+// Viewer side, polled from the render thread once per frame.
+typedef struct {
+    NetSocket socket;
+    NetAddress hostAddress;
+    int mode;
+    uint32_t tableSignature;
+    uint32_t session;
+    bool welcomed;
+    bool rejected;
+    double lastHelloTime;
+    double lastAckTime;
+    double lastReceiveTime;
+    double stepSeconds;
+    uint32_t sendInterval;
+    double renderDelaySteps;
+
+    // State viewers.
+    NetStateFrame frames[NET_HISTORY];
+    uint32_t newestStep;
+    double clockOffset;
+    bool clockValid;
+
+    // Input viewers push every mask, in step order, into a lockstep sim.
+    StepInputQueue *inputs;
+    uint32_t inputSteps;
+} NetClient;
+
+static inline void ClientSendControl(NetClient *client, uint32_t type, uint32_t value, bool withMode) {
+    uint8_t bytes[32];
+    NetWriter writer = {bytes, sizeof(bytes), 0, false};
+    NetWriteHeader(&writer, type, client->session);
+    if (withMode) NetWriteU8(&writer, (uint32_t)client->mode);
+    if (type != NET_PACKET_BYE) NetWriteU32(&writer, value);
+    NetSend(client->socket, client->hostAddress, bytes, writer.size);
+}
+
+static inline bool StartNetClient(NetClient *client, const Table *table, NetAddress hostAddress, int mode, StepInputQueue *inputs) {
+    memset(client, 0, sizeof(*client));
+    client->hostAddress = hostAddress;
+    client->mode = mode;
+    client->tableSignature = NetTableSignature(table);
+    client->stepSeconds = table->physics.fixedDeltaTime;
+    client->sendInterval = NetSendInterval(table);
+    client->renderDelaySteps = (double)client->sendInterval + NET_INTERPOLATION_DELAY_STEPS;
+    client->inputs = inputs;
+    for (int i = 0; i < NET_HISTORY; i++) client->frames[i].step = NET_NO_BASELINE;
+
+    if (!NetStartup()) return false;
+    if (!NetOpenSocket(0, &client->socket)) {
+        NetCleanup();
+        return false;
+    }
+    client->lastHelloTime = TimerNowSeconds();
+    ClientSendControl(client, NET_PACKET_HELLO, client->tableSignature, true);
+    return true;
+}
+
+static inline void StopNetClient(NetClient *client) {
+    if (client->welcomed) ClientSendControl(client, NET_PACKET_BYE, 0, false);
+    NetCloseSocket(client->socket);
+    NetCleanup();
+}
+
+static inline void HandleClientState(NetClient *client, NetReader *reader, double now) {
+    uint32_t step = NetReadVarint(reader);
+    uint32_t back = NetReadVarint(reader);
+    if (reader->failed || step == 0 || step == NET_NO_BASELINE || back >= step) return;
+    uint32_t baseline = back == 0 ? NET_NO_BASELINE : step - back;
+    uint32_t span = NET_HISTORY * client->sendInterval;
+    if (step + span <= client->newestStep || client->frames[NetHistorySlot(step, client->sendInterval)].step == step) return;
+
+    const int32_t *base = NULL;
+    if (baseline != NET_NO_BASELINE) {
+        const NetStateFrame *baseFrame = &client->frames[NetHistorySlot(baseline, client->sendInterval)];
+        if (baseFrame->step != baseline) return;
+        base = baseFrame->fields;
+    }
+    NetStateFrame frame;
+    frame.step = step;
+    if (!ReadStateDelta(reader, base, frame.fields)) return;
+    client->frames[NetHistorySlot(step, client->sendInterval)] = frame;
+    if (step <= client->newestStep) return;
+
+    // Host step clock: local time in steps plus an offset, eased towards each
+    // new sample and snapped when far off.
+    client->newestStep = step;
+    double sample = (double)step - now / client->stepSeconds;
+    if (!client->clockValid || fabs(sample - client->clockOffset) > NET_CLOCK_SNAP_STEPS) {
+        client->clockOffset = sample;
+        client->clockValid = true;
+    } else {
+        client->clockOffset += (sample - client->clockOffset) * NET_CLOCK_SMOOTHING;
+    }
+}
+
+static inline void HandleClientInputs(NetClient *client, NetReader *reader) {
+    uint32_t first = NetReadU32(reader);
+    uint32_t count = NetReadU16(reader);
+    if (reader->failed || first == 0 || !client->inputs) return;
+    for (uint32_t i = 0; i < count; i += 4) {
+        uint32_t packed = NetReadU8(reader);
+        if (reader->failed) return;
+        for (uint32_t j = i; j < count && j < i + 4; j++) {
+            if (first + j != client->inputSteps + 1) continue;
+            if (!PushStepInput(client->inputs, packed >> ((j - i) * NET_INPUT_BITS) & 3u)) return;
+            client->inputSteps++;
+        }
+    }
+}
+
+static inline void UpdateNetClient(NetClient *client, double now) {
+    if (!client->welcomed && !client->rejected && now - client->lastHelloTime > NET_HELLO_SECONDS) {
+        client->lastHelloTime = now;
+        ClientSendControl(client, NET_PACKET_HELLO, client->tableSignature, true);
+    }
+
+    uint8_t buffer[NET_MAX_PACKET];
+    NetAddress from;
+    int size;
+    while ((size = NetReceive(client->socket, &from, buffer, sizeof(buffer))) > 0) {
+        if (!NetSameAddress(from, client->hostAddress)) continue;
+        NetReader reader = {buffer, size, 0, false};
+        uint32_t type, session;
+        if (!NetReadHeader(&reader, &type, &session)) continue;
+        if (type == NET_PACKET_WELCOME) {
+            bool accepted = NetReadU8(&reader) == 1u && !reader.failed;
+            if (client->welcomed) continue;
+            client->welcomed = accepted;
+            client->rejected = !accepted;
+            client->session = session;
+            client->lastAckTime = now;
+        } else if (client->welcomed && session == client->session) {
+            client->lastReceiveTime = now;
+            if (type == NET_PACKET_STATE && client->mode == NET_MODE_STATE) HandleClientState(client, &reader, now);
+            if (type == NET_PACKET_INPUTS && client->mode == NET_MODE_INPUT) HandleClientInputs(client, &reader);
+        }
+    }
+
+    if (client->welcomed && now - client->lastAckTime > NET_ACK_SECONDS) {
+        client->lastAckTime = now;
+        ClientSendControl(client, NET_PACKET_ACK, client->mode == NET_MODE_STATE ? client->newestStep : client->inputSteps, false);
+    }
+}
+
+static inline void DequantiseFrame(const Table *table, const NetStateFrame *frame, float *x, float *y, float *radius,
+                                   FlipperPose *poses) {
+    const int32_t *ballFields = frame->fields + 2 + MAX_FLIPPERS;
+    for (int i = 0; i < frame->fields[1]; i++) {
+        x[i] = (float)ballFields[i * 3] / NET_POSITION_SCALE;
+        y[i] = (float)ballFields[i * 3 + 1] / NET_POSITION_SCALE;
+        if (radius) radius[i] = (float)ballFields[i * 3 + 2] / NET_POSITION_SCALE;
+    }
+    for (int i = 0; i < table->flipperCount; i++) {
+        poses[i] = ComputeFlipperPose(&table->flippers[i], (float)frame->fields[2 + i] / NET_ANGLE_SCALE);
+    }
+}
+
+static inline const NetStateFrame *ReceivedFrame(const NetClient *client, uint32_t step) {
+    const NetStateFrame *frame = &client->frames[NetHistorySlot(step, client->sendInterval)];
+    return frame->step == step ? frame : NULL;
+}
+
+// Fills the snapshot with the received steps around the host clock, one
+// packet and a few steps back, and returns the blend factor between them.
+// Leaves the snapshot alone and returns 1 until the first state arrives. A
+// lost step is bridged by blending across the gap; past the newest step the
+// picture holds.
+static inline float NetClientSnapshot(const NetClient *client, const Table *table, double now, SimSnapshot *snapshot) {
+    if (!client->clockValid) return 1.0f;
+    double renderStep = now / client->stepSeconds + client->clockOffset - client->renderDelaySteps;
+    if (renderStep > (double)client->newestStep) renderStep = (double)client->newestStep;
+
+    const NetStateFrame *from = NULL;
+    const NetStateFrame *to = NULL;
+    uint32_t wanted = renderStep > 1.0 ? (uint32_t)renderStep : 1u;
+    uint32_t span = NET_HISTORY * client->sendInterval;
+    for (uint32_t step = wanted; step > 0 && step + span > wanted && !from; step--) from = ReceivedFrame(client, step);
+    if (!from) from = &client->frames[NetHistorySlot(client->newestStep, client->sendInterval)];
+    for (uint32_t step = from->step + 1; step <= client->newestStep && !to; step++) to = ReceivedFrame(client, step);
+    float alpha = 1.0f;
+    if (to) {
+        alpha = (float)((renderStep - (double)from->step) / (double)(to->step - from->step));
+        if (alpha < 0.0f) alpha = 0.0f;
+        if (alpha > 1.0f) alpha = 1.0f;
+    } else {
+        to = from;
+    }
+
+    DequantiseFrame(table, to, snapshot->x, snapshot->y, snapshot->radius, snapshot->flipperPoses);
+    DequantiseFrame(table, from, snapshot->previousX, snapshot->previousY, NULL, snapshot->previousFlipperPoses);
+    snapshot->ballCount = to->fields[1];
+    // A ball that only exists in the newer step appears where it is.
+    for (int i = from->fields[1]; i < snapshot->ballCount; i++) {
+        snapshot->previousX[i] = snapshot->x[i];
+        snapshot->previousY[i] = snapshot->y[i];
+    }
+    snapshot->score = to->fields[0];
+    snapshot->stepCount = to->step;
+    return alpha;
+}
+
+#endif
@@ -0,0 +1,173 @@
+#ifndef PINBALL_PARTICLES_H
+#define PINBALL_PARTICLES_H
+
+#include "raylib.h"
+#include "rlgl.h"
+#include "arena.h"
+#include "events.h"
+#include <math.h>
+#include <stdint.h>
+
+// Spark bursts at collision points. Particles live in a fixed-capacity
+// structure-of-arrays pool allocated from the session arena: spawning appends,
+// dead particles are swap-removed, and one flat loop advances them all. The
+// draw streams every particle as a textured quad straight into the rlgl
+// batch, so the whole system is one texture bind and a handful of batch
+// flushes however many sparks are alive.
+
+#define PARTICLE_CAPACITY 32768
+#define PARTICLE_BURST_MIN 2
+#define PARTICLE_BURST_MAX 24
+#define PARTICLE_IMPULSE_PER_SPARK 40.0f
+#define PARTICLE_LIFETIME 0.45f
+#define PARTICLE_GRAVITY 600.0f
+#define PARTICLE_DRAG 3.0f
+#define PARTICLE_SIZE 6.0f
+#define PARTICLE_DRAW_CHUNK 1024
+
+typedef struct {
+    int count;
+    int capacity;
+    int peakCount;
+    float *x;
+    float *y;
+    float *velocityX;
+    float *velocityY;
+    float *life;
+    float *inverseLifetime;
+    uint32_t *color;
+    CollisionEventQueue *queue;
+    int consumer;
+    uint32_t seed;
+    Texture2D sprite;
+} ParticleSystem;
+
+// Takes the pool from the arena and registers as an event consumer. Without
+// room in either the system stays empty and every call is a no-op.
+static inline void InitParticleSystem(ParticleSystem *system, Arena *arena, CollisionEventQueue *queue) {
+    memset(system, 0, sizeof(*system));
+    system->seed = 0x9e3779b9u;
+    system->consumer = -1;
+    float *storage = (float *)ArenaAlloc(arena, (size_t)PARTICLE_CAPACITY * 7 * sizeof(float));
+    if (!storage) return;
+    system->capacity = PARTICLE_CAPACITY;
+    system->x = storage;
+    system->y = storage + PARTICLE_CAPACITY;
+    system->velocityX = storage + PARTICLE_CAPACITY * 2;
+    system->velocityY = storage + PARTICLE_CAPACITY * 3;
+    system->life = storage + PARTICLE_CAPACITY * 4;
+    system->inverseLifetime = storage + PARTICLE_CAPACITY * 5;
+    system->color = (uint32_t *)(storage + PARTICLE_CAPACITY * 6);
+    system->queue = queue;
+    system->consumer = AddCollisionEventConsumer(queue);
+
+    Image dot = GenImageGradientRadial(16, 16, 0.0f, WHITE, BLANK);
+    system->sprite = LoadTextureFromImage(dot);
+    UnloadImage(dot);
+}
+
+static inline void UnloadParticleSystem(ParticleSystem *system) {
+    if (system->sprite.id != 0) UnloadTexture(system->sprite);
+    system->sprite = (Texture2D){0};
+}
+
+static inline float NextParticleRandom(ParticleSystem *system) {
+    system->seed ^= system->seed << 13;
+    system->seed ^= system->seed >> 17;
+    system->seed ^= system->seed << 5;
+    return (float)(system->seed >> 8) / 16777216.0f;
+}
+
+static inline void SpawnParticleBurst(ParticleSystem *system, const CollisionEvent *event) {
+    int sparks = (int)(event->impulse / PARTICLE_IMPULSE_PER_SPARK);
+    if (sparks < PARTICLE_BURST_MIN) return;
+    if (sparks > PARTICLE_BURST_MAX) sparks = PARTICLE_BURST_MAX;
+    Color tint = event->colliderKind == COLLIDER_FLIPPER ? (Color){255, 190, 90, 255} : (Color){120, 200, 255, 255};
+    uint32_t packed = (uint32_t)tint.r | (uint32_t)tint.g << 8 | (uint32_t)tint.b << 16 | (uint32_t)tint.a << 24;
+    float speed = 40.0f + sqrtf(event->impulse) * 8.0f;
+
+    for (int i = 0; i < sparks && system->count < system->capacity; i++) {
+        int index = system->count++;
+        float directionX, directionY;
+        SinCosf(NextParticleRandom(system) * 2.0f * PI, &directionY, &directionX);
+        float sparkSpeed = speed * (0.4f + 0.6f * NextParticleRandom(system));
+        float lifetime = PARTICLE_LIFETIME * (0.6f + 0.4f * NextParticleRandom(system));
+        system->x[index] = event->x;
+        system->y[index] = event->y;
+        system->velocityX[index] = directionX * sparkSpeed;
+        system->velocityY[index] = directionY * sparkSpeed;
+        system->life[index] = lifetime;
+        system->inverseLifetime[index] = 1.0f / lifetime;
+        system->color[index] = packed;
+    }
+    if (system->count > system->peakCount) system->peakCount = system->count;
+}
+
+static inline void RemoveDeadParticles(ParticleSystem *system) {
+    for (int i = system->count - 1; i >= 0; i--) {
+        if (system->life[i] > 0.0f) continue;
+        int last = --system->count;
+        system->x[i] = system->x[last];
+        system->y[i] = system->y[last];
+        system->velocityX[i] = system->velocityX[last];
+        system->velocityY[i] = system->velocityY[last];
+        system->life[i] = system->life[last];
+        system->inverseLifetime[i] = system->inverseLifetime[last];
+        system->color[i] = system->color[last];
+    }
+}
+
+// Drains new collision events into bursts, then advances every particle by
+// one frame. The update loop has no branches so it vectorises.
+static inline void UpdateParticles(ParticleSystem *system, float deltaTime) {
+    if (system->consumer < 0) return;
+    CollisionEvent event;
+    while (PopCollisionEvent(system->queue, system->consumer, &event)) SpawnParticleBurst(system, &event);
+
+    const float damping = 1.0f / (1.0f + PARTICLE_DRAG * deltaTime);
+    const float gravityStep = PARTICLE_GRAVITY * deltaTime;
+    float *restrict x = system->x;
+    float *restrict y = system->y;
+    float *restrict velocityX = system->velocityX;
+    float *restrict velocityY = system->velocityY;
+    float *restrict life = system->life;
+    for (int i = 0; i < system->count; i++) {
+        velocityX[i] *= damping;
+        velocityY[i] = velocityY[i] * damping + gravityStep;
+        x[i] += velocityX[i] * deltaTime;
+        y[i] += velocityY[i] * deltaTime;
+        life[i] -= deltaTime;
+    }
+    RemoveDeadParticles(system);
+}
+
+// Additive quads that shrink and fade with age. Space for each chunk is
+// reserved up front; rlgl flushes and restores the texture when the batch is full.
+static inline void DrawParticles(const ParticleSystem *system) {
+    if (system->count == 0 || system->sprite.id == 0) return;
+
+    BeginBlendMode(BLEND_ADDITIVE);
+    rlSetTexture(system->sprite.id);
+    rlBegin(RL_QUADS);
+    for (int i = 0; i < system->count; i++) {
+        if (i % PARTICLE_DRAW_CHUNK == 0) rlCheckRenderBatchLimit(4 * PARTICLE_DRAW_CHUNK);
+        float fade = system->life[i] * system->inverseLifetime[i];
+        float half = PARTICLE_SIZE * (0.3f + 0.7f * fade);
+        uint32_t color = system->color[i];
+        rlColor4ub((unsigned char)color, (unsigned char)(color >> 8), (unsigned char)(color >> 16),
+                   (unsigned char)(255.0f * fade));
+        rlTexCoord2f(0.0f, 0.0f);
+        rlVertex2f(system->x[i] - half, system->y[i] - half);
+        rlTexCoord2f(0.0f, 1.0f);
+        rlVertex2f(system->x[i] - half, system->y[i] + half);
+        rlTexCoord2f(1.0f, 1.0f);
+        rlVertex2f(system->x[i] + half, system->y[i] + half);
+        rlTexCoord2f(1.0f, 0.0f);
+        rlVertex2f(system->x[i] + half, system->y[i] - half);
+    }
+    rlEnd();
+    rlSetTexture(0);
+    EndBlendMode();
+}
+
+#endif
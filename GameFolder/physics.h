@@ -0,0 +1,1299 @@
+#ifndef PINBALL_PHYSICS_H
+#define PINBALL_PHYSICS_H
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "profiler.h"
+#include "rules.h"
+#include "simd.h"
+#include "trig.h"
+
+#ifndef DEG2RAD
+#define DEG2RAD (3.14159265358979323846f / 180.0f)
+#endif
+
+#define MAX_PLANETS 256
+#define MAX_SEGMENTS 1024
+#define MAX_FLIPPERS 8
+#define GRID_CELL_SIZE 64.0f
+#define MAX_GRID_CELLS 1024
+#define MAX_GRID_LANES 4096
+#define MAX_GRID_REFS 4096
+#define WALL_FIELD_MAX_NODES 16384
+#define WALL_RECOVERY_DEPTH 0.5f
+#define CCD_MAX_ITERATIONS 16
+#define CCD_TOLERANCE 0.05f
+#define MULTIBALL_EXTRA_BALLS 2
+#define MAX_STEP_EVENTS 64
+#define BALL_BATCH_FIELDS 9
+
+typedef struct {
+    float x;
+    float y;
+    float radius;
+} Planet;
+
+typedef struct {
+    float x;
+    float y;
+} Vec2f;
+
+typedef struct {
+    Vec2f start;
+    Vec2f end;
+} Segment;
+
+typedef struct {
+    Vec2f pivotPoint;
+    float length;
+    float width;
+    float currentAngle;
+    float restingAngle;
+    float activeAngle;
+    float rotationSpeedDeg;
+    bool isLeftFlipper;
+} Flipper;
+
+// Per-step derived flipper geometry, computed once after the angle update and
+// shared by every ball that touches the flipper during the step.
+typedef struct {
+    Vec2f tip;
+    Vec2f direction;
+    float capRadius;
+    float angularVelocity;
+} FlipperPose;
+
+typedef struct {
+    float x;
+    float y;
+    float radius;
+    float velocityX;
+    float velocityY;
+} Ball;
+
+// Static uniform grid over the table. Every collider is listed in each cell its
+// bounds (grown by the ball radius) touch, so a ball only needs the colliders of
+// the cell holding its centre. Planets are stored per cell as padded SIMD lanes;
+// flippers are listed by their full sweep so they can rotate freely. Walls are
+// not listed here; they live in the WallField.
+typedef struct {
+    float cellSize;
+    int columns;
+    int rows;
+    int laneStart[MAX_GRID_CELLS + 1];
+    float laneX[MAX_GRID_LANES];
+    float laneY[MAX_GRID_LANES];
+    float laneRadius[MAX_GRID_LANES];
+    int16_t lanePlanet[MAX_GRID_LANES];
+    int flipperStart[MAX_GRID_CELLS + 1];
+    int8_t flipperRefs[MAX_GRID_REFS];
+} CollisionGrid;
+
+// Signed distance to the nearest wall segment and its gradient, baked at the
+// nodes of a regular lattice when the table loads. One bilinear sample gives
+// both for any point, however many segments the walls are made of. Walls are
+// one-sided: the open side is on the left going from a segment's start to its
+// end as seen on screen, and points behind a wall get negative distances with
+// the gradient still pointing out to the open side, so a ball pushed into a
+// wall is still sent back the right way. Around free ends the distance is to
+// the end point and always positive.
+typedef struct {
+    float cellSize;
+    int columns;
+    int rows;
+    float distance[WALL_FIELD_MAX_NODES];
+    float normalX[WALL_FIELD_MAX_NODES];
+    float normalY[WALL_FIELD_MAX_NODES];
+} WallField;
+
+typedef struct {
+    float gravityAcceleration;
+    float wallBounceFactor;
+    float planetBounceFactor;
+    float flipperBounceFactor;
+    float flipperImpulseStrength;
+    float flipperVelocityTransfer;
+    float fixedDeltaTime;
+    bool continuousCollision;
+} PhysicsConfig;
+
+// Production physics profile, also the built-in table's settings. The step
+// covers one of PHYSICS_SUBSTEPS slices of a PHYSICS_FRAME_RATE frame.
+#define PHYSICS_PROFILE_GRAVITY 1200.0f
+#define PHYSICS_PROFILE_WALL_BOUNCE 0.7f
+#define PHYSICS_PROFILE_PLANET_BOUNCE 0.85f
+#define PHYSICS_PROFILE_FLIPPER_BOUNCE 0.90f
+#define PHYSICS_PROFILE_FLIPPER_IMPULSE 280.0f
+#define PHYSICS_PROFILE_FLIPPER_TRANSFER 0.5f
+#define PHYSICS_PROFILE_CONTINUOUS true
+#define PHYSICS_FRAME_RATE 60
+#define PHYSICS_SUBSTEPS 6
+#define PHYSICS_PROFILE_STEP_SECONDS (1.0f / (PHYSICS_FRAME_RATE * PHYSICS_SUBSTEPS))
+
+// The default build reads every constant from the table's PhysicsConfig so
+// tables can be tuned without recompiling. PINBALL_PHYSICS_FIXED bakes the
+// production profile in as literals instead, letting the compiler fold the
+// step length and coefficients into the inner loops; tables whose physics
+// differ are then refused at load time (see PhysicsMatchesProfile).
+#if defined(PINBALL_PHYSICS_FIXED)
+#define PHYSICS_PROFILE_NAME "fixed"
+#define PHYSICS_VALUE(config, field, value) ((void)(config), (value))
+#else
+#define PHYSICS_PROFILE_NAME "tunable"
+#define PHYSICS_VALUE(config, field, value) ((config)->field)
+#endif
+
+#define PHYSICS_GRAVITY(config) PHYSICS_VALUE(config, gravityAcceleration, PHYSICS_PROFILE_GRAVITY)
+#define PHYSICS_WALL_BOUNCE(config) PHYSICS_VALUE(config, wallBounceFactor, PHYSICS_PROFILE_WALL_BOUNCE)
+#define PHYSICS_PLANET_BOUNCE(config) PHYSICS_VALUE(config, planetBounceFactor, PHYSICS_PROFILE_PLANET_BOUNCE)
+#define PHYSICS_FLIPPER_BOUNCE(config) PHYSICS_VALUE(config, flipperBounceFactor, PHYSICS_PROFILE_FLIPPER_BOUNCE)
+#define PHYSICS_FLIPPER_IMPULSE(config) PHYSICS_VALUE(config, flipperImpulseStrength, PHYSICS_PROFILE_FLIPPER_IMPULSE)
+#define PHYSICS_FLIPPER_TRANSFER(config) PHYSICS_VALUE(config, flipperVelocityTransfer, PHYSICS_PROFILE_FLIPPER_TRANSFER)
+#define PHYSICS_STEP_SECONDS(config) PHYSICS_VALUE(config, fixedDeltaTime, PHYSICS_PROFILE_STEP_SECONDS)
+#define PHYSICS_CONTINUOUS(config) PHYSICS_VALUE(config, continuousCollision, PHYSICS_PROFILE_CONTINUOUS)
+
+static inline bool PhysicsMatchesProfile(const PhysicsConfig *config) {
+#if defined(PINBALL_PHYSICS_FIXED)
+    return config->gravityAcceleration == PHYSICS_PROFILE_GRAVITY &&
+           config->wallBounceFactor == PHYSICS_PROFILE_WALL_BOUNCE &&
+           config->planetBounceFactor == PHYSICS_PROFILE_PLANET_BOUNCE &&
+           config->flipperBounceFactor == PHYSICS_PROFILE_FLIPPER_BOUNCE &&
+           config->flipperImpulseStrength == PHYSICS_PROFILE_FLIPPER_IMPULSE &&
+           config->flipperVelocityTransfer == PHYSICS_PROFILE_FLIPPER_TRANSFER &&
+           config->fixedDeltaTime == PHYSICS_PROFILE_STEP_SECONDS &&
+           config->continuousCollision == PHYSICS_PROFILE_CONTINUOUS;
+#else
+    (void)config;
+    return true;
+#endif
+}
+
+typedef struct {
+    float width;
+    float height;
+    Vec2f startPoint;
+    Vec2f spawnPoint;
+    float ballRadius;
+    Planet planets[MAX_PLANETS];
+    int planetCount;
+    Segment segments[MAX_SEGMENTS];
+    int segmentCount;
+    Flipper flippers[MAX_FLIPPERS];
+    int flipperBaseScore[MAX_FLIPPERS];
+    int flipperCount;
+    int planetScore;
+    int multiballJackpotScore;
+    RuleProgram rules;
+    PhysicsConfig physics;
+    CollisionGrid grid;
+    WallField walls;
+} Table;
+
+typedef struct {
+    int count;
+    int capacity;
+    int peakCount;
+    float *x;
+    float *y;
+    float *velocityX;
+    float *velocityY;
+    float *radius;
+    float *previousX;
+    float *previousY;
+    float *stepStartX;
+    float *stepStartY;
+} BallBatch;
+
+enum {
+    COLLIDER_FLIPPER = 1,
+    COLLIDER_PLANET = 2
+};
+
+// One contact reported by a step. substepTime is the fraction of the step at
+// which the contact happened (swept contacts land inside it, discrete ones at
+// the end), impulse is the change in ball speed it caused and x, y is where
+// the ball ended up after it.
+typedef struct {
+    uint64_t step;
+    float substepTime;
+    float impulse;
+    float x;
+    float y;
+    uint16_t colliderKind;
+    uint16_t colliderIndex;
+} CollisionEvent;
+
+typedef struct {
+    BallBatch balls;
+    Flipper flippers[MAX_FLIPPERS];
+    FlipperPose flipperPoses[MAX_FLIPPERS];
+    FlipperPose flipperStartPoses[MAX_FLIPPERS];
+    float flipperStartAngles[MAX_FLIPPERS];
+    bool flipperActive[MAX_FLIPPERS];
+    int score;
+    int nextJackpotScore;
+    // Set when the last ball drains, just before the score resets.
+    int lastGameScore;
+    float lastDrainX;
+    int32_t ruleRegisters[RULE_REGISTER_COUNT];
+    uint64_t stepCount;
+    CollisionEvent stepEvents[MAX_STEP_EVENTS];
+    int stepEventCount;
+} GameState;
+
+enum {
+    INPUT_LEFT_FLIPPER = 1 << 0,
+    INPUT_RIGHT_FLIPPER = 1 << 1
+};
+
+enum {
+    STEP_EVENT_COLLISION = 1 << 0,
+    STEP_EVENT_DRAIN = 1 << 1,
+    STEP_EVENT_GAME_OVER = 1 << 2
+};
+
+static inline Vec2f RotatePoint(Vec2f point, Vec2f pivot, float angle) {
+    float sinAngle, cosAngle;
+    SinCosf(angle, &sinAngle, &cosAngle);
+    float translatedX = point.x - pivot.x;
+    float translatedY = point.y - pivot.y;
+    Vec2f rotatedPoint = {
+        translatedX * cosAngle - translatedY * sinAngle + pivot.x,
+        translatedX * sinAngle + translatedY * cosAngle + pivot.y
+    };
+    return rotatedPoint;
+}
+
+static inline float ClosestPointOnSegment(Vec2f segmentStart, Vec2f segmentEnd, Vec2f point, Vec2f *closestPoint) {
+    float segmentDirX = segmentEnd.x - segmentStart.x;
+    float segmentDirY = segmentEnd.y - segmentStart.y;
+    float pointDirX = point.x - segmentStart.x;
+    float pointDirY = point.y - segmentStart.y;
+    float segmentLengthSquared = segmentDirX * segmentDirX + segmentDirY * segmentDirY;
+    float projectionParameter = 0.0f;
+
+    if (segmentLengthSquared > 1e-8f) {
+        projectionParameter = (pointDirX * segmentDirX + pointDirY * segmentDirY) / segmentLengthSquared;
+    }
+
+    if (projectionParameter < 0.0f) projectionParameter = 0.0f;
+    if (projectionParameter > 1.0f) projectionParameter = 1.0f;
+
+    if (closestPoint) {
+        closestPoint->x = segmentStart.x + segmentDirX * projectionParameter;
+        closestPoint->y = segmentStart.y + segmentDirY * projectionParameter;
+    }
+    return projectionParameter;
+}
+
+static inline float SegmentSide(Vec2f segmentStart, Vec2f segmentEnd, Vec2f point) {
+    return (segmentEnd.x - segmentStart.x) * (point.y - segmentStart.y) -
+           (segmentEnd.y - segmentStart.y) * (point.x - segmentStart.x);
+}
+
+static inline void ReflectVelocity(Ball *ball, float normalX, float normalY, float bounceFactor) {
+    float dotProduct = ball->velocityX * normalX + ball->velocityY * normalY;
+    ball->velocityX -= 2.0f * dotProduct * normalX;
+    ball->velocityY -= 2.0f * dotProduct * normalY;
+    ball->velocityX *= bounceFactor;
+    ball->velocityY *= bounceFactor;
+}
+
+static inline bool SeparateCircleFromSegment(Ball *ball, Vec2f segmentStart, Vec2f segmentEnd) {
+    Vec2f closestPoint;
+    ClosestPointOnSegment(segmentStart, segmentEnd, (Vec2f){ball->x, ball->y}, &closestPoint);
+    float deltaX = ball->x - closestPoint.x;
+    float deltaY = ball->y - closestPoint.y;
+    float distance = sqrtf(deltaX * deltaX + deltaY * deltaY);
+
+    if (distance < 1e-5f) distance = 1e-5f;
+
+    if (distance < ball->radius) {
+        float normalX = deltaX / distance;
+        float normalY = deltaY / distance;
+        ball->x = closestPoint.x + normalX * ball->radius;
+        ball->y = closestPoint.y + normalY * ball->radius;
+        return true;
+    }
+    return false;
+}
+
+static inline int CountTrailingZeros(uint32_t value) {
+#if defined(__GNUC__)
+    return __builtin_ctz(value);
+#else
+    int count = 0;
+    while (!(value & 1u)) { value >>= 1; count++; }
+    return count;
+#endif
+}
+
+static inline bool CellOverlapsBounds(const CollisionGrid *grid, int column, int row,
+                                      float minX, float minY, float maxX, float maxY) {
+    float cellMinX = column * grid->cellSize, cellMinY = row * grid->cellSize;
+    return maxX >= cellMinX && minX <= cellMinX + grid->cellSize &&
+           maxY >= cellMinY && minY <= cellMinY + grid->cellSize;
+}
+
+static inline bool FillCollisionGrid(Table *table, float cellSize) {
+    CollisionGrid *grid = &table->grid;
+    const float margin = table->ballRadius + 1.0f;
+    grid->cellSize = cellSize;
+    grid->columns = (int)ceilf(table->width / cellSize);
+    grid->rows = (int)ceilf((table->height + 100.0f + table->ballRadius) / cellSize);
+    if (grid->columns < 1) grid->columns = 1;
+    if (grid->rows < 1) grid->rows = 1;
+    if (grid->columns * grid->rows > MAX_GRID_CELLS) return false;
+
+    int laneCount = 0, flipperRefCount = 0;
+
+    for (int row = 0; row < grid->rows; row++) {
+        for (int column = 0; column < grid->columns; column++) {
+            int cell = row * grid->columns + column;
+
+            grid->laneStart[cell] = laneCount;
+            for (int i = 0; i < table->planetCount; i++) {
+                const Planet *planet = &table->planets[i];
+                float reach = planet->radius + margin;
+                if (!CellOverlapsBounds(grid, column, row, planet->x - reach, planet->y - reach,
+                                        planet->x + reach, planet->y + reach)) continue;
+                if (laneCount >= MAX_GRID_LANES) return false;
+                grid->laneX[laneCount] = planet->x;
+                grid->laneY[laneCount] = planet->y;
+                grid->laneRadius[laneCount] = planet->radius;
+                grid->lanePlanet[laneCount] = (int16_t)i;
+                laneCount++;
+            }
+            while ((laneCount - grid->laneStart[cell]) % SIMD_LANES != 0) {
+                if (laneCount >= MAX_GRID_LANES) return false;
+                grid->laneX[laneCount] = -1e6f;
+                grid->laneY[laneCount] = -1e6f;
+                grid->laneRadius[laneCount] = 0.0f;
+                grid->lanePlanet[laneCount] = -1;
+                laneCount++;
+            }
+
+            grid->flipperStart[cell] = flipperRefCount;
+            for (int i = 0; i < table->flipperCount; i++) {
+                const Flipper *flipper = &table->flippers[i];
+                float reach = flipper->length + flipper->width * 0.5f + margin;
+                if (!CellOverlapsBounds(grid, column, row, flipper->pivotPoint.x - reach, flipper->pivotPoint.y - reach,
+                                        flipper->pivotPoint.x + reach, flipper->pivotPoint.y + reach)) continue;
+                if (flipperRefCount >= MAX_GRID_REFS) return false;
+                grid->flipperRefs[flipperRefCount++] = (int8_t)i;
+            }
+        }
+    }
+
+    int cellCount = grid->columns * grid->rows;
+    grid->laneStart[cellCount] = laneCount;
+    grid->flipperStart[cellCount] = flipperRefCount;
+    return true;
+}
+
+static inline void BakeWallField(Table *table) {
+    WallField *field = &table->walls;
+    float fieldHeight = table->height + 100.0f + table->ballRadius;
+    field->cellSize = fmaxf(table->ballRadius * 0.5f, 1.0f);
+    for (;;) {
+        field->columns = (int)ceilf(table->width / field->cellSize) + 1;
+        field->rows = (int)ceilf(fieldHeight / field->cellSize) + 1;
+        if (field->columns * field->rows <= WALL_FIELD_MAX_NODES) break;
+        field->cellSize *= 1.25f;
+    }
+
+    for (int row = 0; row < field->rows; row++) {
+        for (int column = 0; column < field->columns; column++) {
+            Vec2f node = {column * field->cellSize, row * field->cellSize};
+            float bestDistance = 1e6f, signedDistance = 1e6f, normalX = 0.0f, normalY = 0.0f;
+
+            for (int i = 0; i < table->segmentCount; i++) {
+                const Segment *segment = &table->segments[i];
+                Vec2f closestPoint;
+                float along = ClosestPointOnSegment(segment->start, segment->end, node, &closestPoint);
+                float deltaX = node.x - closestPoint.x, deltaY = node.y - closestPoint.y;
+                float distance = sqrtf(deltaX * deltaX + deltaY * deltaY);
+                if (distance >= bestDistance) continue;
+                bestDistance = distance;
+
+                bool behind = along > 0.0f && along < 1.0f && SegmentSide(segment->start, segment->end, node) > 0.0f;
+                float sign = behind ? -1.0f : 1.0f;
+                if (distance > 1e-5f) {
+                    normalX = sign * deltaX / distance;
+                    normalY = sign * deltaY / distance;
+                } else {
+                    float edgeX = segment->end.x - segment->start.x, edgeY = segment->end.y - segment->start.y;
+                    float edgeLength = fmaxf(sqrtf(edgeX * edgeX + edgeY * edgeY), 1e-5f);
+                    normalX = edgeY / edgeLength;
+                    normalY = -edgeX / edgeLength;
+                }
+                signedDistance = sign * distance;
+            }
+
+            int index = row * field->columns + column;
+            field->distance[index] = signedDistance;
+            field->normalX[index] = normalX;
+            field->normalY[index] = normalY;
+        }
+    }
+}
+
+// Rebuilds the broad-phase grid and bakes the wall field. Must be called
+// whenever the table's static colliders change. Grid cells are grown until
+// everything fits the fixed storage.
+static inline void BuildCollisionGrid(Table *table) {
+    float cellSize = GRID_CELL_SIZE;
+    while (!FillCollisionGrid(table, cellSize)) cellSize *= 2.0f;
+    BakeWallField(table);
+}
+
+static inline int GridCellAt(const CollisionGrid *grid, float x, float y) {
+    int column = (int)(x / grid->cellSize);
+    int row = (int)(y / grid->cellSize);
+    if (column < 0) column = 0;
+    if (column >= grid->columns) column = grid->columns - 1;
+    if (row < 0) row = 0;
+    if (row >= grid->rows) row = grid->rows - 1;
+    return row * grid->columns + column;
+}
+
+// Finds the lattice cell holding a point (clamped to the field) and the
+// point's position inside it.
+static inline int WallFieldCell(const WallField *field, float x, float y, float *fractionX, float *fractionY) {
+    float gridX = fminf(fmaxf(x / field->cellSize, 0.0f), (float)(field->columns - 1));
+    float gridY = fminf(fmaxf(y / field->cellSize, 0.0f), (float)(field->rows - 1));
+    int column = (int)gridX, row = (int)gridY;
+    if (column > field->columns - 2) column = field->columns - 2;
+    if (row > field->rows - 2) row = field->rows - 2;
+    *fractionX = gridX - (float)column;
+    *fractionY = gridY - (float)row;
+    return row * field->columns + column;
+}
+
+static inline float BilinearSample(const float *values, int index, int columns, float fractionX, float fractionY) {
+    float top = values[index] + (values[index + 1] - values[index]) * fractionX;
+    float bottom = values[index + columns] + (values[index + columns + 1] - values[index + columns]) * fractionX;
+    return top + (bottom - top) * fractionY;
+}
+
+// Interpolated signed distance to the nearest wall. Off by at most one cell
+// diagonal from the exact distance, and exact along straight walls.
+static inline float WallDistance(const WallField *field, float x, float y) {
+    float fractionX, fractionY;
+    int index = WallFieldCell(field, x, y, &fractionX, &fractionY);
+    return BilinearSample(field->distance, index, field->columns, fractionX, fractionY);
+}
+
+static inline float SampleWallField(const WallField *field, float x, float y, float *normalX, float *normalY) {
+    float fractionX, fractionY;
+    int index = WallFieldCell(field, x, y, &fractionX, &fractionY);
+    *normalX = BilinearSample(field->normalX, index, field->columns, fractionX, fractionY);
+    *normalY = BilinearSample(field->normalY, index, field->columns, fractionX, fractionY);
+    return BilinearSample(field->distance, index, field->columns, fractionX, fractionY);
+}
+
+static inline void InitDefaultTable(Table *table) {
+    memset(table, 0, sizeof(*table));
+    table->width = 600.0f;
+    table->height = 900.0f;
+    table->startPoint = (Vec2f){460.0f, 450.0f};
+    table->spawnPoint = (Vec2f){300.0f, 450.0f};
+    table->ballRadius = 14.0f;
+
+    table->planetCount = 6;
+    table->planets[0] = (Planet){270, 320, 85};
+    table->planets[1] = (Planet){480, 120, 55};
+    table->planets[2] = (Planet){90, 120, 75};
+    table->planets[3] = (Planet){480, 320, 48};
+    table->planets[4] = (Planet){65, 470, 52};
+    table->planets[5] = (Planet){500, 500, 50};
+
+    table->flippers[0] = (Flipper){
+        {table->width / 2.0f - 100.0f, table->height - 150.0f},
+        80.0f, 15.0f,
+        15.0f * DEG2RAD, 15.0f * DEG2RAD, -45.0f * DEG2RAD,
+        480.0f, true
+    };
+    table->flippers[1] = (Flipper){
+        {table->width / 2.0f + 100.0f, table->height - 150.0f},
+        80.0f, 15.0f,
+        165.0f * DEG2RAD, 165.0f * DEG2RAD, 225.0f * DEG2RAD,
+        480.0f, false
+    };
+    float boundaryYCenter = table->flippers[0].pivotPoint.y - 35.0f;
+    float boundarySlope = 20.0f;
+    table->segmentCount = 2;
+    table->segments[0] = (Segment){{0, boundaryYCenter - boundarySlope}, {table->flippers[0].pivotPoint.x, boundaryYCenter + boundarySlope}};
+    table->segments[1] = (Segment){{table->flippers[1].pivotPoint.x, boundaryYCenter + boundarySlope}, {table->width, boundaryYCenter - boundarySlope}};
+
+    table->flipperCount = 2;
+    table->flipperBaseScore[0] = 10;
+    table->flipperBaseScore[1] = 15;
+    table->planetScore = 5;
+    table->multiballJackpotScore = 1000;
+    InitDefaultRules(&table->rules);
+
+    table->physics.gravityAcceleration = PHYSICS_PROFILE_GRAVITY;
+    table->physics.wallBounceFactor = PHYSICS_PROFILE_WALL_BOUNCE;
+    table->physics.planetBounceFactor = PHYSICS_PROFILE_PLANET_BOUNCE;
+    table->physics.flipperBounceFactor = PHYSICS_PROFILE_FLIPPER_BOUNCE;
+    table->physics.flipperImpulseStrength = PHYSICS_PROFILE_FLIPPER_IMPULSE;
+    table->physics.flipperVelocityTransfer = PHYSICS_PROFILE_FLIPPER_TRANSFER;
+    table->physics.fixedDeltaTime = PHYSICS_PROFILE_STEP_SECONDS;
+    table->physics.continuousCollision = PHYSICS_PROFILE_CONTINUOUS;
+    BuildCollisionGrid(table);
+}
+
+// Points the batch at caller-owned storage of capacity * BALL_BATCH_FIELDS floats.
+static inline void AttachBallBatch(BallBatch *balls, float *storage, int capacity) {
+    memset(balls, 0, sizeof(*balls));
+    balls->capacity = capacity;
+    balls->x = storage;
+    balls->y = storage + capacity;
+    balls->velocityX = storage + capacity * 2;
+    balls->velocityY = storage + capacity * 3;
+    balls->radius = storage + capacity * 4;
+    balls->previousX = storage + capacity * 5;
+    balls->previousY = storage + capacity * 6;
+    balls->stepStartX = storage + capacity * 7;
+    balls->stepStartY = storage + capacity * 8;
+}
+
+static inline bool InitBallBatch(BallBatch *balls, int capacity) {
+    float *storage = (float *)calloc((size_t)capacity * BALL_BATCH_FIELDS, sizeof(float));
+    if (!storage) return false;
+    AttachBallBatch(balls, storage, capacity);
+    return true;
+}
+
+static inline void FreeBallBatch(BallBatch *balls) {
+    free(balls->x);
+    memset(balls, 0, sizeof(*balls));
+}
+
+static inline int AddBall(BallBatch *balls, Ball ball) {
+    if (balls->count >= balls->capacity) return -1;
+    int index = balls->count++;
+    if (balls->count > balls->peakCount) balls->peakCount = balls->count;
+    balls->x[index] = balls->previousX[index] = balls->stepStartX[index] = ball.x;
+    balls->y[index] = balls->previousY[index] = balls->stepStartY[index] = ball.y;
+    balls->velocityX[index] = ball.velocityX;
+    balls->velocityY[index] = ball.velocityY;
+    balls->radius[index] = ball.radius;
+    return index;
+}
+
+static inline void RemoveBall(BallBatch *balls, int index) {
+    int last = --balls->count;
+    balls->x[index] = balls->x[last];
+    balls->y[index] = balls->y[last];
+    balls->velocityX[index] = balls->velocityX[last];
+    balls->velocityY[index] = balls->velocityY[last];
+    balls->radius[index] = balls->radius[last];
+    balls->previousX[index] = balls->previousX[last];
+    balls->previousY[index] = balls->previousY[last];
+    balls->stepStartX[index] = balls->stepStartX[last];
+    balls->stepStartY[index] = balls->stepStartY[last];
+}
+
+static inline Ball GetBall(const BallBatch *balls, int index) {
+    Ball ball = {balls->x[index], balls->y[index], balls->radius[index], balls->velocityX[index], balls->velocityY[index]};
+    return ball;
+}
+
+static inline void SetBall(BallBatch *balls, int index, Ball ball) {
+    balls->x[index] = ball.x;
+    balls->y[index] = ball.y;
+    balls->radius[index] = ball.radius;
+    balls->velocityX[index] = ball.velocityX;
+    balls->velocityY[index] = ball.velocityY;
+}
+
+// Contacts past MAX_STEP_EVENTS in one step still resolve, they are just not
+// reported; that only happens with large ball batches.
+static inline void RecordCollision(GameState *state, int colliderKind, int colliderIndex,
+                                   float substepTime, float velocityX, float velocityY, const Ball *ball) {
+    if (state->stepEventCount >= MAX_STEP_EVENTS) return;
+    CollisionEvent *event = &state->stepEvents[state->stepEventCount++];
+    event->step = state->stepCount;
+    event->substepTime = substepTime;
+    event->impulse = hypotf(ball->velocityX - velocityX, ball->velocityY - velocityY);
+    event->x = ball->x;
+    event->y = ball->y;
+    event->colliderKind = (uint16_t)colliderKind;
+    event->colliderIndex = (uint16_t)colliderIndex;
+}
+
+static inline void SaveBallPositions(BallBatch *balls) {
+    memcpy(balls->previousX, balls->x, (size_t)balls->count * sizeof(float));
+    memcpy(balls->previousY, balls->y, (size_t)balls->count * sizeof(float));
+}
+
+static inline FlipperPose ComputeFlipperPose(const Flipper *flipper, float angle) {
+    FlipperPose pose;
+    SinCosf(angle, &pose.direction.y, &pose.direction.x);
+    pose.tip = (Vec2f){flipper->pivotPoint.x + flipper->length * pose.direction.x,
+                       flipper->pivotPoint.y + flipper->length * pose.direction.y};
+    pose.capRadius = flipper->width * 0.5f;
+    float angularDirection = (angle - flipper->restingAngle) > 0 ? 1.0f : -1.0f;
+    pose.angularVelocity = angularDirection * flipper->rotationSpeedDeg * DEG2RAD;
+    return pose;
+}
+
+// Blends two cached poses of the same flipper without trig: the direction is
+// lerped and renormalised, which stays on the arc for the small angle a
+// flipper covers in one step. Used to draw between physics steps.
+static inline FlipperPose InterpolateFlipperPose(const Flipper *flipper, const FlipperPose *from, const FlipperPose *to, float alpha) {
+    FlipperPose pose = *to;
+    float directionX = from->direction.x + (to->direction.x - from->direction.x) * alpha;
+    float directionY = from->direction.y + (to->direction.y - from->direction.y) * alpha;
+    float length = sqrtf(directionX * directionX + directionY * directionY);
+    if (length < 1e-6f) return pose;
+    pose.direction = (Vec2f){directionX / length, directionY / length};
+    pose.tip = (Vec2f){flipper->pivotPoint.x + flipper->length * pose.direction.x,
+                       flipper->pivotPoint.y + flipper->length * pose.direction.y};
+    return pose;
+}
+
+// Scoring runs through the table's rule program (rules.h): every contact,
+// drain and game start is an event, with the contact's table value as input.
+static inline void RunTableRules(const Table *table, GameState *state, int kind, int index, int value) {
+    if (!(table->rules.eventMask & (1u << kind))) return;
+    PROFILE_BEGIN(PROFILE_RULES);
+    RuleEvent event = {kind, index, value, (int32_t)state->stepCount, state->balls.count};
+    int executed = RunRules(&table->rules, &event, state->ruleRegisters, &state->score);
+    (void)executed;
+    PROFILE_COUNT(PROFILE_RULE_EVENTS, 1);
+    PROFILE_COUNT(PROFILE_RULE_OPS, executed);
+    PROFILE_END(PROFILE_RULES);
+}
+
+static inline void StartRuleGame(const Table *table, GameState *state) {
+    memset(state->ruleRegisters, 0, sizeof(state->ruleRegisters));
+    RunTableRules(table, state, RULE_EVENT_RESET, 0, 0);
+}
+
+static inline void ResetGameState(const Table *table, GameState *state) {
+    state->balls.count = 0;
+    AddBall(&state->balls, (Ball){table->startPoint.x, table->startPoint.y, table->ballRadius, 0.0f, 0.0f});
+    for (int i = 0; i < table->flipperCount; i++) {
+        state->flippers[i] = table->flippers[i];
+        state->flipperPoses[i] = ComputeFlipperPose(&state->flippers[i], state->flippers[i].currentAngle);
+        state->flipperActive[i] = false;
+    }
+    state->score = 0;
+    state->nextJackpotScore = table->multiballJackpotScore;
+    state->stepCount = 0;
+    StartRuleGame(table, state);
+}
+
+// Moves a game onto an edited table without restarting it. Balls, score and
+// step count are kept and take the new ball radius; flippers take the new
+// geometry but stay at their current angle, clamped to the new range.
+static inline void RebindGameState(const Table *table, GameState *state) {
+    for (int i = 0; i < state->balls.count; i++) state->balls.radius[i] = table->ballRadius;
+    for (int i = 0; i < MAX_FLIPPERS; i++) {
+        Flipper *flipper = &state->flippers[i];
+        float angle = flipper->currentAngle;
+        bool existed = flipper->length > 0.0f;
+        *flipper = i < table->flipperCount ? table->flippers[i] : (Flipper){0};
+        if (i >= table->flipperCount) continue;
+        float low = fminf(flipper->restingAngle, flipper->activeAngle);
+        float high = fmaxf(flipper->restingAngle, flipper->activeAngle);
+        if (existed) flipper->currentAngle = fminf(fmaxf(angle, low), high);
+        state->flipperPoses[i] = ComputeFlipperPose(flipper, flipper->currentAngle);
+    }
+}
+
+static inline bool InitGameState(const Table *table, GameState *state, int ballCapacity) {
+    memset(state, 0, sizeof(*state));
+    if (ballCapacity < 1) ballCapacity = 1;
+    if (!InitBallBatch(&state->balls, ballCapacity)) return false;
+    ResetGameState(table, state);
+    return true;
+}
+
+// Same with caller-owned ball storage of ballCapacity * BALL_BATCH_FIELDS
+// floats (e.g. from the session arena); such states are not passed to FreeGameState.
+static inline void InitGameStateWithStorage(const Table *table, GameState *state, float *ballStorage, int ballCapacity) {
+    memset(state, 0, sizeof(*state));
+    AttachBallBatch(&state->balls, ballStorage, ballCapacity);
+    ResetGameState(table, state);
+}
+
+static inline void FreeGameState(GameState *state) {
+    FreeBallBatch(&state->balls);
+}
+
+static inline void UpdateFlipperAngle(Flipper *flipper, bool active, float deltaTime) {
+    float targetAngle = active ? flipper->activeAngle : flipper->restingAngle;
+    float rotationSpeedRad = flipper->rotationSpeedDeg * DEG2RAD;
+
+    if (flipper->currentAngle < targetAngle) {
+        flipper->currentAngle += rotationSpeedRad * deltaTime;
+        if (flipper->currentAngle > targetAngle) flipper->currentAngle = targetAngle;
+    } else if (flipper->currentAngle > targetAngle) {
+        flipper->currentAngle -= rotationSpeedRad * deltaTime;
+        if (flipper->currentAngle < targetAngle) flipper->currentAngle = targetAngle;
+    }
+}
+
+static inline void IntegrateBalls(const Table *table, BallBatch *balls) {
+    const PhysicsConfig *config = &table->physics;
+    const float substepDeltaTime = PHYSICS_STEP_SECONDS(config);
+    const float gravityStep = PHYSICS_GRAVITY(config) * substepDeltaTime;
+    const float bounce = -PHYSICS_WALL_BOUNCE(config);
+    const float tableWidth = table->width;
+    float *restrict x = balls->x;
+    float *restrict y = balls->y;
+    float *restrict velocityX = balls->velocityX;
+    float *restrict velocityY = balls->velocityY;
+    const float *restrict radius = balls->radius;
+
+    memcpy(balls->stepStartX, x, (size_t)balls->count * sizeof(float));
+    memcpy(balls->stepStartY, y, (size_t)balls->count * sizeof(float));
+
+    for (int i = 0; i < balls->count; i++) {
+        velocityY[i] += gravityStep;
+        x[i] += velocityX[i] * substepDeltaTime;
+        y[i] += velocityY[i] * substepDeltaTime;
+
+        bool hitLeft = x[i] - radius[i] < 0;
+        x[i] = hitLeft ? radius[i] : x[i];
+        velocityX[i] = hitLeft ? velocityX[i] * bounce : velocityX[i];
+
+        bool hitRight = x[i] + radius[i] > tableWidth;
+        x[i] = hitRight ? tableWidth - radius[i] : x[i];
+        velocityX[i] = hitRight ? velocityX[i] * bounce : velocityX[i];
+
+        bool hitTop = y[i] - radius[i] < 0;
+        y[i] = hitTop ? radius[i] : y[i];
+        velocityY[i] = hitTop ? velocityY[i] * bounce : velocityY[i];
+    }
+}
+
+static inline int RemoveDrainedBalls(const Table *table, GameState *state) {
+    BallBatch *balls = &state->balls;
+    int events = 0;
+
+    for (int i = balls->count - 1; i >= 0; i--) {
+        if (balls->y[i] <= table->height + 100) continue;
+        events |= STEP_EVENT_DRAIN;
+        RunTableRules(table, state, RULE_EVENT_DRAIN, 0, 0);
+
+        if (balls->count > 1) {
+            RemoveBall(balls, i);
+        } else {
+            events |= STEP_EVENT_GAME_OVER;
+            state->lastGameScore = state->score;
+            state->lastDrainX = balls->x[i];
+            balls->x[i] = balls->previousX[i] = balls->stepStartX[i] = table->spawnPoint.x;
+            balls->y[i] = balls->previousY[i] = balls->stepStartY[i] = table->spawnPoint.y;
+            balls->velocityX[i] = 0;
+            balls->velocityY[i] = 0;
+            state->score = 0;
+            state->nextJackpotScore = table->multiballJackpotScore;
+            StartRuleGame(table, state);
+        }
+    }
+    return events;
+}
+
+// Earliest time in [0,1] at which a circle moving start->end touches the
+// segment, treating the segment as a capsule of the circle's radius.
+static inline bool SweptCircleSegmentTime(Vec2f start, Vec2f end, float radius,
+                                          Vec2f segmentStart, Vec2f segmentEnd, float *hitTime) {
+    float travelX = end.x - start.x, travelY = end.y - start.y;
+    float edgeX = segmentEnd.x - segmentStart.x, edgeY = segmentEnd.y - segmentStart.y;
+    float edgeLength = sqrtf(edgeX * edgeX + edgeY * edgeY);
+    float bestTime = 2.0f;
+
+    if (edgeLength > 1e-6f) {
+        float normalX = -edgeY / edgeLength, normalY = edgeX / edgeLength;
+        float startSide = (start.x - segmentStart.x) * normalX + (start.y - segmentStart.y) * normalY;
+        float endSide = (end.x - segmentStart.x) * normalX + (end.y - segmentStart.y) * normalY;
+        float offset = startSide > 0.0f ? radius : -radius;
+
+        if (fabsf(startSide) <= radius) {
+            float along = ((start.x - segmentStart.x) * edgeX + (start.y - segmentStart.y) * edgeY) / (edgeLength * edgeLength);
+            if (along >= 0.0f && along <= 1.0f) bestTime = 0.0f;
+        } else if (fabsf(startSide - endSide) > 1e-9f) {
+            float time = (offset - startSide) / (endSide - startSide);
+            if (time >= 0.0f && time <= 1.0f) {
+                float along = ((start.x + travelX * time - segmentStart.x) * edgeX +
+                               (start.y + travelY * time - segmentStart.y) * edgeY) / (edgeLength * edgeLength);
+                if (along >= 0.0f && along <= 1.0f) bestTime = time;
+            }
+        }
+    }
+
+    Vec2f endpoints[2] = {segmentStart, segmentEnd};
+    float travelSquared = travelX * travelX + travelY * travelY;
+    for (int i = 0; i < 2 && travelSquared > 1e-12f; i++) {
+        float offsetX = start.x - endpoints[i].x, offsetY = start.y - endpoints[i].y;
+        float halfB = offsetX * travelX + offsetY * travelY;
+        float c = offsetX * offsetX + offsetY * offsetY - radius * radius;
+        float discriminant = halfB * halfB - travelSquared * c;
+        if (c <= 0.0f || halfB >= 0.0f || discriminant < 0.0f) continue;
+        float time = (-halfB - sqrtf(discriminant)) / travelSquared;
+        if (time <= 1.0f && time < bestTime) bestTime = time;
+    }
+
+    if (bestTime > 1.0f) return false;
+    *hitTime = bestTime;
+    return true;
+}
+
+// Catches balls whose path crossed a boundary segment during the step. The
+// ball is moved to the first contact and the rest of its travel is kept only
+// along the segment, which is where the discrete separation would have left it
+// had the step been short enough.
+static inline void SweepBallAgainstSegments(const Table *table, Vec2f stepStart, Ball *ball) {
+    Vec2f stepEnd = {ball->x, ball->y};
+    float firstHit = 2.0f;
+    int hitSegment = -1;
+
+    // The centre cannot cross a wall that is further away than the whole
+    // step's travel, which rules out the segment loop for almost every ball.
+    const WallField *field = &table->walls;
+    float travel = hypotf(stepEnd.x - stepStart.x, stepEnd.y - stepStart.y);
+    if (travel < fabsf(WallDistance(field, stepStart.x, stepStart.y)) - field->cellSize * 1.5f) return;
+    PROFILE_COUNT(PROFILE_SEGMENT_CHECKS, table->segmentCount);
+
+    for (int i = 0; i < table->segmentCount; i++) {
+        const Segment *segment = &table->segments[i];
+        float startSide = SegmentSide(segment->start, segment->end, stepStart);
+        float endSide = SegmentSide(segment->start, segment->end, stepEnd);
+        if ((startSide > 0.0f) == (endSide > 0.0f)) continue;
+
+        float hitTime = 1.0f;
+        if (SweptCircleSegmentTime(stepStart, stepEnd, ball->radius, segment->start, segment->end, &hitTime) &&
+            hitTime < firstHit) {
+            firstHit = hitTime;
+            hitSegment = i;
+        }
+    }
+
+    if (hitSegment < 0) return;
+    PROFILE_COUNT(PROFILE_SEGMENT_HITS, 1);
+
+    const Segment *segment = &table->segments[hitSegment];
+    Vec2f contact = {stepStart.x + (stepEnd.x - stepStart.x) * firstHit, stepStart.y + (stepEnd.y - stepStart.y) * firstHit};
+    Vec2f closestPoint;
+    ClosestPointOnSegment(segment->start, segment->end, contact, &closestPoint);
+    float normalX = contact.x - closestPoint.x, normalY = contact.y - closestPoint.y;
+    float normalLength = sqrtf(normalX * normalX + normalY * normalY);
+    if (normalLength < 1e-5f) normalLength = 1e-5f;
+    normalX /= normalLength;
+    normalY /= normalLength;
+
+    float remainingX = stepEnd.x - contact.x, remainingY = stepEnd.y - contact.y;
+    float intoSurface = remainingX * normalX + remainingY * normalY;
+    if (intoSurface < 0.0f) {
+        remainingX -= intoSurface * normalX;
+        remainingY -= intoSurface * normalY;
+    }
+    ball->x = contact.x + remainingX;
+    ball->y = contact.y + remainingY;
+}
+
+// Keeps the ball a radius away from the walls along the field's gradient. A
+// centre less than WALL_RECOVERY_DEPTH radii behind a wall is taken to have
+// slipped through and goes back out to the open side; one further back is
+// on the far side, like a ball knocked under a boundary, and is kept off the
+// wall from there so it can fall away. Like the segment separation it
+// replaces, this only corrects the position.
+static inline void SeparateBallFromWalls(const Table *table, Ball *ball) {
+    float normalX, normalY;
+    float distance = SampleWallField(&table->walls, ball->x, ball->y, &normalX, &normalY);
+    PROFILE_COUNT(PROFILE_SEGMENT_CHECKS, 1);
+    if (distance >= ball->radius || distance <= -ball->radius) return;
+
+    float normalLength = sqrtf(normalX * normalX + normalY * normalY);
+    if (normalLength < 1e-5f) return;
+    float push = distance < -ball->radius * WALL_RECOVERY_DEPTH ? -(ball->radius + distance) / normalLength
+                                                                : (ball->radius - distance) / normalLength;
+    ball->x += normalX * push;
+    ball->y += normalY * push;
+    PROFILE_COUNT(PROFILE_SEGMENT_HITS, 1);
+}
+
+static inline void ContactNormal(float deltaX, float deltaY, float *normalX, float *normalY) {
+    float distance = sqrtf(deltaX * deltaX + deltaY * deltaY);
+    if (distance < 1e-5f) distance = 1e-5f;
+    *normalX = deltaX / distance;
+    *normalY = deltaY / distance;
+}
+
+// Where a ball touches a flipper: the tip cap, the body or the pivot cap,
+// whichever the ball is deepest into, in that order on a tie. point is the
+// nearest point on the flipper's core segment, which is also the lever arm for
+// velocity transfer; the ball comes to rest surfaceOffset away from it along
+// the normal. Along the body the normal faces the side of the core segment the
+// ball started the step on, so a ball that got past the core line is sent
+// back the way it came instead of out through the underside.
+typedef struct {
+    Vec2f point;
+    float normalX;
+    float normalY;
+    float surfaceOffset;
+    int score;
+} FlipperContact;
+
+static inline bool FindFlipperContact(const Table *table, const Flipper *flipper, const FlipperPose *pose,
+                                      int flipperIndex, const Ball *ball, float contactSlop, bool startedBehind,
+                                      FlipperContact *contact) {
+    const int baseScore = table->flipperBaseScore[flipperIndex];
+    const float capReach = ball->radius + pose->capRadius;
+
+    float deltaXToTip = ball->x - pose->tip.x;
+    float deltaYToTip = ball->y - pose->tip.y;
+    float tipGap = sqrtf(deltaXToTip * deltaXToTip + deltaYToTip * deltaYToTip) - capReach;
+
+    Vec2f closestPoint;
+    float segmentParameter = ClosestPointOnSegment(flipper->pivotPoint, pose->tip, (Vec2f){ball->x, ball->y}, &closestPoint);
+    float deltaX = ball->x - closestPoint.x;
+    float deltaY = ball->y - closestPoint.y;
+    float bodyGap = sqrtf(deltaX * deltaX + deltaY * deltaY) - ball->radius;
+
+    float deltaXToPivot = ball->x - flipper->pivotPoint.x;
+    float deltaYToPivot = ball->y - flipper->pivotPoint.y;
+    float pivotGap = sqrtf(deltaXToPivot * deltaXToPivot + deltaYToPivot * deltaYToPivot) - capReach;
+
+    if (tipGap < contactSlop && tipGap <= bodyGap && tipGap <= pivotGap) {
+        ContactNormal(deltaXToTip, deltaYToTip, &contact->normalX, &contact->normalY);
+        contact->point = pose->tip;
+        contact->surfaceOffset = capReach;
+        contact->score = baseScore;
+        return true;
+    }
+
+    if (bodyGap <= contactSlop && bodyGap <= pivotGap) {
+        if (segmentParameter > 0.0f && segmentParameter < 1.0f) {
+            // (-edgeY, edgeX) is on the segment's behind side (SegmentSide > 0).
+            float edgeX = pose->tip.x - flipper->pivotPoint.x, edgeY = pose->tip.y - flipper->pivotPoint.y;
+            float side = startedBehind ? 1.0f : -1.0f;
+            ContactNormal(-edgeY * side, edgeX * side, &contact->normalX, &contact->normalY);
+        } else {
+            ContactNormal(deltaX, deltaY, &contact->normalX, &contact->normalY);
+        }
+        contact->point = closestPoint;
+        contact->surfaceOffset = ball->radius;
+        contact->score = (int)(baseScore * (0.5f + segmentParameter * 0.5f));
+        return true;
+    }
+
+    if (pivotGap < contactSlop) {
+        ContactNormal(deltaXToPivot, deltaYToPivot, &contact->normalX, &contact->normalY);
+        contact->point = flipper->pivotPoint;
+        contact->surfaceOffset = capReach;
+        contact->score = baseScore / 2;
+        return true;
+    }
+    return false;
+}
+
+// Discrete contact against one flipper pose. contactSlop widens the contact
+// test so a ball placed on the surface by the swept test still registers.
+// Both responses are computed and one is selected, so the per-contact work
+// does not branch on whether the flipper is held; at the pivot the lever arm
+// is zero and only the push remains. points receives the contact's table value.
+static inline bool ResolveFlipperContact(const Table *table, const Flipper *flipper, const FlipperPose *pose,
+                                         int flipperIndex, Ball *ball, bool active, float contactSlop,
+                                         bool startedBehind, int *points) {
+    const PhysicsConfig *config = &table->physics;
+    const float impulse = PHYSICS_FLIPPER_IMPULSE(config);
+    const float substepDeltaTime = PHYSICS_STEP_SECONDS(config);
+    const float transfer = PHYSICS_FLIPPER_TRANSFER(config);
+    const float bounce = PHYSICS_FLIPPER_BOUNCE(config);
+
+    FlipperContact contact;
+    if (!FindFlipperContact(table, flipper, pose, flipperIndex, ball, contactSlop, startedBehind, &contact)) return false;
+    float normalX = contact.normalX, normalY = contact.normalY;
+
+    float surfaceVelocityX = -pose->angularVelocity * (contact.point.y - flipper->pivotPoint.y);
+    float surfaceVelocityY = pose->angularVelocity * (contact.point.x - flipper->pivotPoint.x);
+    float pushedX = ball->velocityX + normalX * impulse * substepDeltaTime + surfaceVelocityX * transfer;
+    float pushedY = ball->velocityY + normalY * impulse * substepDeltaTime + surfaceVelocityY * transfer;
+
+    float dotProduct = ball->velocityX * normalX + ball->velocityY * normalY;
+    float reflectedX = (ball->velocityX - 2.0f * dotProduct * normalX) * bounce;
+    float reflectedY = (ball->velocityY - 2.0f * dotProduct * normalY) * bounce;
+
+    ball->velocityX = active ? pushedX : reflectedX;
+    ball->velocityY = active ? pushedY : reflectedY;
+    ball->x = contact.point.x + normalX * contact.surfaceOffset;
+    ball->y = contact.point.y + normalY * contact.surfaceOffset;
+    *points = contact.score;
+    return true;
+}
+
+static inline float FlipperSurfaceDistance(const Flipper *flipper, float angle, Vec2f point, float radius) {
+    float sinAngle, cosAngle;
+    SinCosf(angle, &sinAngle, &cosAngle);
+    Vec2f tip = {flipper->pivotPoint.x + flipper->length * cosAngle, flipper->pivotPoint.y + flipper->length * sinAngle};
+    float capRadius = flipper->width * 0.5f;
+    Vec2f closestPoint;
+    ClosestPointOnSegment(flipper->pivotPoint, tip, point, &closestPoint);
+
+    float bodyDistance = hypotf(point.x - closestPoint.x, point.y - closestPoint.y) - radius;
+    float tipDistance = hypotf(point.x - tip.x, point.y - tip.y) - radius - capRadius;
+    float pivotDistance = hypotf(point.x - flipper->pivotPoint.x, point.y - flipper->pivotPoint.y) - radius - capRadius;
+    return fminf(bodyDistance, fminf(tipDistance, pivotDistance));
+}
+
+// Conservative advancement of a ball moving start->end against a flipper
+// rotating startAngle->endAngle over the same step. Time advances by the current
+// gap over the fastest possible closing speed, so the first contact is never
+// stepped over. A ball that starts the step on the surface, as the previous
+// contact leaves it, is a hit at time 0 if it is closing in; otherwise the
+// sweep carries on from the point where it has moved clear of the surface.
+static inline bool SweptCircleFlipperTime(const Flipper *flipper, float startAngle, float endAngle,
+                                          Vec2f start, Vec2f end, float radius, float *hitTime) {
+    float travelX = end.x - start.x, travelY = end.y - start.y;
+    float reach = flipper->length + flipper->width * 0.5f + radius;
+    Vec2f closestToPivot;
+    ClosestPointOnSegment(start, end, flipper->pivotPoint, &closestToPivot);
+    float pivotGapX = closestToPivot.x - flipper->pivotPoint.x, pivotGapY = closestToPivot.y - flipper->pivotPoint.y;
+    if (pivotGapX * pivotGapX + pivotGapY * pivotGapY > reach * reach) return false;
+
+    float closingSpeed = sqrtf(travelX * travelX + travelY * travelY) +
+                         fabsf(endAngle - startAngle) * (flipper->length + flipper->width * 0.5f);
+    if (closingSpeed < 1e-6f) return false;
+
+    float time = 0.0f;
+    float gap = FlipperSurfaceDistance(flipper, startAngle, start, radius);
+    if (gap <= CCD_TOLERANCE) {
+        float clearTime = 2.0f * CCD_TOLERANCE / closingSpeed;
+        if (clearTime > 1.0f) return false;
+        Vec2f point = {start.x + travelX * clearTime, start.y + travelY * clearTime};
+        float clearGap = FlipperSurfaceDistance(flipper, startAngle + (endAngle - startAngle) * clearTime, point, radius);
+        if (clearGap <= gap) {
+            *hitTime = 0.0f;
+            return true;
+        }
+        time = clearTime;
+        gap = fmaxf(clearGap, CCD_TOLERANCE);
+    }
+
+    for (int iteration = 0; iteration < CCD_MAX_ITERATIONS; iteration++) {
+        time += gap / closingSpeed;
+        if (time > 1.0f) return false;
+        Vec2f point = {start.x + travelX * time, start.y + travelY * time};
+        gap = FlipperSurfaceDistance(flipper, startAngle + (endAngle - startAngle) * time, point, radius);
+        if (gap < CCD_TOLERANCE) {
+            *hitTime = time;
+            return true;
+        }
+    }
+    return false;
+}
+
+static inline bool ResolveFlipperContacts(const Table *table, GameState *state, Ball *ball, Vec2f stepStart) {
+    const CollisionGrid *grid = &table->grid;
+    bool collided = false;
+    uint32_t sweptMask = 0;
+
+    if (PHYSICS_CONTINUOUS(&table->physics)) {
+        Vec2f stepEnd = {ball->x, ball->y};
+        PROFILE_COUNT(PROFILE_FLIPPER_CHECKS, table->flipperCount);
+        for (int flipperIndex = 0; flipperIndex < table->flipperCount; flipperIndex++) {
+            const Flipper *flipper = &state->flippers[flipperIndex];
+            const FlipperPose *startPose = &state->flipperStartPoses[flipperIndex];
+            const FlipperPose *endPose = &state->flipperPoses[flipperIndex];
+            float startAngle = state->flipperStartAngles[flipperIndex];
+            bool startedBehind = SegmentSide(flipper->pivotPoint, startPose->tip, stepStart) > 0.0f;
+            float hitTime = 1.0f;
+            if (!SweptCircleFlipperTime(flipper, startAngle, flipper->currentAngle,
+                                        stepStart, stepEnd, ball->radius, &hitTime)) continue;
+
+            // Only intervene when the ball went through the flipper or grazed it and
+            // left again; contacts still visible at the end of the step stay discrete.
+            bool crossed = startedBehind != (SegmentSide(flipper->pivotPoint, endPose->tip, stepEnd) > 0.0f);
+            float endGap = FlipperSurfaceDistance(flipper, flipper->currentAngle, stepEnd, ball->radius);
+            if (!crossed && endGap < CCD_TOLERANCE) continue;
+
+            float contactAngle = startAngle + (flipper->currentAngle - startAngle) * hitTime;
+            FlipperPose contactPose = ComputeFlipperPose(flipper, contactAngle);
+            ball->x = stepStart.x + (stepEnd.x - stepStart.x) * hitTime;
+            ball->y = stepStart.y + (stepEnd.y - stepStart.y) * hitTime;
+            float velocityX = ball->velocityX, velocityY = ball->velocityY;
+            int points;
+            if (ResolveFlipperContact(table, flipper, &contactPose, flipperIndex, ball,
+                                      state->flipperActive[flipperIndex], 2.0f * CCD_TOLERANCE, startedBehind, &points)) {
+                RecordCollision(state, COLLIDER_FLIPPER, flipperIndex, hitTime, velocityX, velocityY, ball);
+                RunTableRules(table, state, COLLIDER_FLIPPER, flipperIndex, points);
+                PROFILE_COUNT(PROFILE_FLIPPER_HITS, 1);
+                collided = true;
+            }
+            sweptMask |= 1u << flipperIndex;
+            stepEnd = (Vec2f){ball->x, ball->y};
+        }
+    }
+
+    int cell = GridCellAt(grid, ball->x, ball->y);
+    PROFILE_COUNT(PROFILE_FLIPPER_CHECKS, grid->flipperStart[cell + 1] - grid->flipperStart[cell]);
+    for (int ref = grid->flipperStart[cell]; ref < grid->flipperStart[cell + 1]; ref++) {
+        int flipperIndex = grid->flipperRefs[ref];
+        if (sweptMask & (1u << flipperIndex)) continue;
+        const Flipper *flipper = &state->flippers[flipperIndex];
+        bool startedBehind = SegmentSide(flipper->pivotPoint, state->flipperStartPoses[flipperIndex].tip, stepStart) > 0.0f;
+        float velocityX = ball->velocityX, velocityY = ball->velocityY;
+        int points;
+        if (ResolveFlipperContact(table, flipper, &state->flipperPoses[flipperIndex], flipperIndex,
+                                  ball, state->flipperActive[flipperIndex], 0.0f, startedBehind, &points)) {
+            RecordCollision(state, COLLIDER_FLIPPER, flipperIndex, 1.0f, velocityX, velocityY, ball);
+            RunTableRules(table, state, COLLIDER_FLIPPER, flipperIndex, points);
+            PROFILE_COUNT(PROFILE_FLIPPER_HITS, 1);
+            collided = true;
+        }
+    }
+    return collided;
+}
+
+static inline bool ResolvePlanetContacts(const Table *table, GameState *state) {
+    const float bounceFactor = PHYSICS_PLANET_BOUNCE(&table->physics);
+    BallBatch *balls = &state->balls;
+    bool collided = false;
+
+    const CollisionGrid *grid = &table->grid;
+
+    for (int i = 0; i < balls->count; i++) {
+        int cell = GridCellAt(grid, balls->x[i], balls->y[i]);
+        PROFILE_COUNT(PROFILE_PLANET_CHECKS, grid->laneStart[cell + 1] - grid->laneStart[cell]);
+
+        for (int base = grid->laneStart[cell]; base < grid->laneStart[cell + 1]; base += SIMD_LANES) {
+            uint32_t contactMask = CircleOverlapMask(&grid->laneX[base], &grid->laneY[base], &grid->laneRadius[base],
+                                                     balls->x[i], balls->y[i], balls->radius[i]);
+
+            while (contactMask) {
+                int planetIndex = grid->lanePlanet[base + CountTrailingZeros(contactMask)];
+                const Planet *planet = &table->planets[planetIndex];
+                contactMask &= contactMask - 1;
+
+                float deltaX = balls->x[i] - planet->x;
+                float deltaY = balls->y[i] - planet->y;
+                float distance = sqrtf(deltaX * deltaX + deltaY * deltaY);
+                float minimumDistance = balls->radius[i] + planet->radius;
+
+                if (distance < minimumDistance && distance > 1e-5f) {
+                    float normalX = deltaX / distance;
+                    float normalY = deltaY / distance;
+
+                    Ball ball = GetBall(balls, i);
+                    float velocityX = ball.velocityX, velocityY = ball.velocityY;
+                    ReflectVelocity(&ball, normalX, normalY, bounceFactor);
+                    ball.x = planet->x + normalX * minimumDistance;
+                    ball.y = planet->y + normalY * minimumDistance;
+                    SetBall(balls, i, ball);
+                    RecordCollision(state, COLLIDER_PLANET, planetIndex, 1.0f, velocityX, velocityY, &ball);
+                    PROFILE_COUNT(PROFILE_PLANET_HITS, 1);
+                    RunTableRules(table, state, COLLIDER_PLANET, planetIndex, table->planetScore);
+                    collided = true;
+                }
+            }
+        }
+    }
+    return collided;
+}
+
+static inline void LaunchMultiball(const Table *table, GameState *state) {
+    for (int i = 0; i < MULTIBALL_EXTRA_BALLS; i++) {
+        float direction = (i % 2 == 0) ? -1.0f : 1.0f;
+        Ball ball = {table->spawnPoint.x, table->spawnPoint.y, table->ballRadius,
+                     direction * (120.0f + 60.0f * (float)(i / 2)), -300.0f};
+        AddBall(&state->balls, ball);
+    }
+}
+
+// Moves every flipper towards its target and refreshes the pose cache. The
+// previous pose is kept as the start of the step for the swept tests, and
+// trig only runs for flippers that actually moved.
+static inline void UpdateFlippers(const Table *table, GameState *state, unsigned int inputMask, float deltaTime) {
+    for (int i = 0; i < table->flipperCount; i++) {
+        Flipper *flipper = &state->flippers[i];
+        bool active = (inputMask & (flipper->isLeftFlipper ? INPUT_LEFT_FLIPPER : INPUT_RIGHT_FLIPPER)) != 0;
+        float startAngle = flipper->currentAngle;
+
+        state->flipperActive[i] = active;
+        state->flipperStartAngles[i] = startAngle;
+        state->flipperStartPoses[i] = state->flipperPoses[i];
+        UpdateFlipperAngle(flipper, active, deltaTime);
+        if (flipper->currentAngle != startAngle) {
+            state->flipperPoses[i] = ComputeFlipperPose(flipper, flipper->currentAngle);
+        }
+    }
+}
+
+// Advances the table by one fixed step. Returns a mask of STEP_EVENT_* flags;
+// the individual contacts of the step are left in state->stepEvents.
+static inline int StepPhysics(const Table *table, GameState *state, unsigned int inputMask) {
+    BallBatch *balls = &state->balls;
+    const float substepDeltaTime = PHYSICS_STEP_SECONDS(&table->physics);
+    int events = 0;
+
+    state->stepEventCount = 0;
+    PROFILE_BEGIN(PROFILE_FLIPPERS);
+    UpdateFlippers(table, state, inputMask, substepDeltaTime);
+    PROFILE_END(PROFILE_FLIPPERS);
+
+    PROFILE_BEGIN(PROFILE_INTEGRATION);
+    IntegrateBalls(table, balls);
+    events |= RemoveDrainedBalls(table, state);
+    PROFILE_END(PROFILE_INTEGRATION);
+
+    for (int i = 0; i < balls->count; i++) {
+        Ball ball = GetBall(balls, i);
+        Vec2f stepStart = {balls->stepStartX[i], balls->stepStartY[i]};
+        PROFILE_BEGIN(PROFILE_BOUNDARY);
+        if (PHYSICS_CONTINUOUS(&table->physics)) SweepBallAgainstSegments(table, stepStart, &ball);
+        SeparateBallFromWalls(table, &ball);
+        PROFILE_END(PROFILE_BOUNDARY);
+        PROFILE_BEGIN(PROFILE_FLIPPER_CONTACTS);
+        if (ResolveFlipperContacts(table, state, &ball, stepStart)) events |= STEP_EVENT_COLLISION;
+        PROFILE_END(PROFILE_FLIPPER_CONTACTS);
+        SetBall(balls, i, ball);
+    }
+
+    PROFILE_BEGIN(PROFILE_PLANETS);
+    if (ResolvePlanetContacts(table, state)) events |= STEP_EVENT_COLLISION;
+    PROFILE_END(PROFILE_PLANETS);
+
+    if (table->multiballJackpotScore > 0 && balls->count == 1 && state->score >= state->nextJackpotScore) {
+        LaunchMultiball(table, state);
+        state->nextJackpotScore += table->multiballJackpotScore;
+    }
+
+    state->stepCount++;
+    return events;
+}
+
+static inline uint32_t HashBytes(uint32_t hash, const void *data, size_t size) {
+    const unsigned char *bytes = (const unsigned char *)data;
+    for (size_t i = 0; i < size; i++) {
+        hash ^= bytes[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+static inline uint32_t GameStateChecksum(const GameState *state) {
+    uint32_t hash = 2166136261u;
+    const BallBatch *balls = &state->balls;
+    hash = HashBytes(hash, balls->x, (size_t)balls->count * sizeof(float));
+    hash = HashBytes(hash, balls->y, (size_t)balls->count * sizeof(float));
+    hash = HashBytes(hash, balls->velocityX, (size_t)balls->count * sizeof(float));
+    hash = HashBytes(hash, balls->velocityY, (size_t)balls->count * sizeof(float));
+    for (int i = 0; i < MAX_FLIPPERS; i++) {
+        if (state->flippers[i].length <= 0.0f) continue;
+        hash = HashBytes(hash, &state->flippers[i].currentAngle, sizeof(float));
+    }
+    hash = HashBytes(hash, &state->score, sizeof(state->score));
+    return hash;
+}
+
+#endif
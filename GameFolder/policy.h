@@ -0,0 +1,46 @@
+#ifndef PINBALL_POLICY_H
+#define PINBALL_POLICY_H
+
+#include "physics.h"
+
+// Scripted flipper players for the offline tools. The reactive player presses
+// a flipper whenever a falling ball is within the flipper length plus
+// reachMargin of its pivot; the random player flips each side on a seeded
+// coin toss per step.
+
+static inline unsigned int ReactiveFlipperInput(const Table *table, const GameState *state, float reachMargin) {
+    unsigned int inputMask = 0;
+    const BallBatch *balls = &state->balls;
+
+    for (int flipperIndex = 0; flipperIndex < table->flipperCount; flipperIndex++) {
+        const Flipper *flipper = &table->flippers[flipperIndex];
+
+        for (int i = 0; i < balls->count; i++) {
+            float deltaX = balls->x[i] - flipper->pivotPoint.x;
+            float deltaY = balls->y[i] - flipper->pivotPoint.y;
+            float reach = flipper->length + balls->radius[i] + reachMargin;
+
+            if (deltaX * deltaX + deltaY * deltaY < reach * reach && balls->velocityY[i] > 0.0f) {
+                inputMask |= flipper->isLeftFlipper ? INPUT_LEFT_FLIPPER : INPUT_RIGHT_FLIPPER;
+                break;
+            }
+        }
+    }
+    return inputMask;
+}
+
+static inline uint32_t NextPolicyRandom(uint32_t *seed) {
+    *seed = *seed * 1664525u + 1013904223u;
+    return *seed >> 8;
+}
+
+// pressChance is the probability, per step, that a side changes state.
+static inline unsigned int RandomFlipperInput(unsigned int previousMask, float pressChance, uint32_t *seed) {
+    unsigned int inputMask = previousMask;
+    uint32_t threshold = (uint32_t)(pressChance * 16777216.0f);
+    if (NextPolicyRandom(seed) < threshold) inputMask ^= INPUT_LEFT_FLIPPER;
+    if (NextPolicyRandom(seed) < threshold) inputMask ^= INPUT_RIGHT_FLIPPER;
+    return inputMask;
+}
+
+#endif
@@ -0,0 +1,150 @@
+#ifndef PINBALL_POOL_H
+#define PINBALL_POOL_H
+
+#include "thread.h"
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+// Persistent worker pool running parallel-for batches. Each worker owns a
+// range of task indices packed as (begin << 32 | end) in one atomic word; it
+// takes tasks from the front, and once its range is empty it steals the back
+// half of another worker's range. The calling thread works as worker 0, so a
+// pool of one worker runs everything inline.
+
+#define POOL_MAX_WORKERS 64
+#define POOL_SPINS_BEFORE_SLEEP 4096
+
+typedef void (*TaskFunction)(void *context, int taskIndex, int workerIndex);
+
+// Padded to a cache line so workers popping their own ranges do not contend.
+typedef struct {
+    atomic_uint_fast64_t range;
+    char padding[64 - sizeof(atomic_uint_fast64_t)];
+} TaskQueue;
+
+typedef struct TaskPool TaskPool;
+
+typedef struct {
+    TaskPool *pool;
+    int workerIndex;
+} TaskWorker;
+
+struct TaskPool {
+    TaskQueue queues[POOL_MAX_WORKERS];
+    TaskWorker workers[POOL_MAX_WORKERS];
+    Thread threads[POOL_MAX_WORKERS];
+    int workerCount;
+    TaskFunction function;
+    void *context;
+    atomic_uint generation;
+    atomic_int busyWorkers;
+    atomic_bool quit;
+};
+
+static inline uint64_t PackTaskRange(uint32_t begin, uint32_t end) {
+    return ((uint64_t)begin << 32) | end;
+}
+
+static inline bool PopTask(TaskQueue *queue, int *task) {
+    uint64_t range = atomic_load(&queue->range);
+    for (;;) {
+        uint32_t begin = (uint32_t)(range >> 32), end = (uint32_t)range;
+        if (begin >= end) return false;
+        if (atomic_compare_exchange_weak(&queue->range, &range, PackTaskRange(begin + 1, end))) {
+            *task = (int)begin;
+            return true;
+        }
+    }
+}
+
+// Moves the back half of a victim's range into the (empty) queue of the thief.
+// Ranges are disjoint within a batch, so a stale compare-exchange cannot match.
+static inline bool StealTasks(TaskPool *pool, int thief) {
+    for (int offset = 1; offset < pool->workerCount; offset++) {
+        TaskQueue *victim = &pool->queues[(thief + offset) % pool->workerCount];
+        uint64_t range = atomic_load(&victim->range);
+        for (;;) {
+            uint32_t begin = (uint32_t)(range >> 32), end = (uint32_t)range;
+            if (begin >= end) break;
+            uint32_t split = end - (end - begin + 1) / 2;
+            if (atomic_compare_exchange_weak(&victim->range, &range, PackTaskRange(begin, split))) {
+                atomic_store(&pool->queues[thief].range, PackTaskRange(split, end));
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+static inline void DrainTasks(TaskPool *pool, int workerIndex) {
+    int task;
+    do {
+        while (PopTask(&pool->queues[workerIndex], &task)) pool->function(pool->context, task, workerIndex);
+    } while (StealTasks(pool, workerIndex));
+}
+
+static inline int TaskWorkerMain(void *argument) {
+    TaskWorker *worker = (TaskWorker *)argument;
+    TaskPool *pool = worker->pool;
+    unsigned int seenGeneration = 0;
+
+    for (;;) {
+        int spins = 0;
+        while (atomic_load(&pool->generation) == seenGeneration && !atomic_load(&pool->quit)) {
+            if (++spins > POOL_SPINS_BEFORE_SLEEP) ThreadSleepSeconds(0.0001);
+        }
+        if (atomic_load(&pool->quit)) return 0;
+        seenGeneration = atomic_load(&pool->generation);
+
+        DrainTasks(pool, worker->workerIndex);
+        atomic_fetch_sub(&pool->busyWorkers, 1);
+    }
+}
+
+// workerCount <= 0 picks one worker per hardware thread.
+static inline void InitTaskPool(TaskPool *pool, int workerCount) {
+    if (workerCount <= 0) workerCount = ThreadHardwareConcurrency();
+    if (workerCount > POOL_MAX_WORKERS) workerCount = POOL_MAX_WORKERS;
+    pool->workerCount = 1;
+    pool->function = NULL;
+    pool->context = NULL;
+    atomic_init(&pool->generation, 0);
+    atomic_init(&pool->busyWorkers, 0);
+    atomic_init(&pool->quit, false);
+    for (int i = 0; i < POOL_MAX_WORKERS; i++) atomic_init(&pool->queues[i].range, 0);
+
+    for (int i = 1; i < workerCount; i++) {
+        pool->workers[i] = (TaskWorker){pool, i};
+        if (!ThreadStart(&pool->threads[i], TaskWorkerMain, &pool->workers[i])) break;
+        pool->workerCount++;
+    }
+}
+
+// Runs function(context, task, worker) for every task in [0, taskCount) and
+// returns once all of them are done.
+static inline void RunTaskPool(TaskPool *pool, int taskCount, TaskFunction function, void *context) {
+    pool->function = function;
+    pool->context = context;
+    for (int i = 0; i < pool->workerCount; i++) {
+        uint32_t begin = (uint32_t)((int64_t)taskCount * i / pool->workerCount);
+        uint32_t end = (uint32_t)((int64_t)taskCount * (i + 1) / pool->workerCount);
+        atomic_store(&pool->queues[i].range, PackTaskRange(begin, end));
+    }
+
+    atomic_store(&pool->busyWorkers, pool->workerCount - 1);
+    atomic_fetch_add(&pool->generation, 1);
+    DrainTasks(pool, 0);
+    int spins = 0;
+    while (atomic_load(&pool->busyWorkers) > 0) {
+        if (++spins > POOL_SPINS_BEFORE_SLEEP) ThreadSleepSeconds(0.0001);
+    }
+}
+
+static inline void DestroyTaskPool(TaskPool *pool) {
+    atomic_store(&pool->quit, true);
+    for (int i = 1; i < pool->workerCount; i++) ThreadJoin(pool->threads[i]);
+    pool->workerCount = 1;
+}
+
+#endif
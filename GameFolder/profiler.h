@@ -0,0 +1,167 @@
+#ifndef PINBALL_PROFILER_H
+#define PINBALL_PROFILER_H
+
+// Opt-in frame profiler, enabled by building with -DPINBALL_PROFILE. Phases
+// accumulate wall time over a frame (all substeps together) and the last
+// PROFILE_WINDOW frames are kept for percentiles. A phase begun inside another
+// one is taken out of the outer phase, so the phases of a frame never overlap
+// and add up to the time they cover. Without the define the
+// PROFILE_* macros compile to nothing, so the physics step is unchanged.
+
+enum {
+    PROFILE_INPUT,
+    PROFILE_FLIPPERS,
+    PROFILE_INTEGRATION,
+    PROFILE_BOUNDARY,
+    PROFILE_FLIPPER_CONTACTS,
+    PROFILE_PLANETS,
+    PROFILE_RULES,
+    PROFILE_DRAW,
+    PROFILE_PRESENT,
+    PROFILE_PHASE_COUNT
+};
+
+enum {
+    PROFILE_SEGMENT_CHECKS,
+    PROFILE_SEGMENT_HITS,
+    PROFILE_FLIPPER_CHECKS,
+    PROFILE_FLIPPER_HITS,
+    PROFILE_PLANET_CHECKS,
+    PROFILE_PLANET_HITS,
+    PROFILE_RULE_EVENTS,
+    PROFILE_RULE_OPS,
+    PROFILE_COUNTER_COUNT
+};
+
+#if defined(PINBALL_PROFILE)
+#include "timer.h"
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define PROFILE_WINDOW 240
+
+static const char *const profilePhaseNames[PROFILE_PHASE_COUNT] = {
+    "input", "flippers", "integration", "boundary", "flipper", "planet", "rules", "draw", "present"
+};
+
+static const char *const profileCounterNames[PROFILE_COUNTER_COUNT] = {
+    "segment_checks", "segment_hits", "flipper_checks", "flipper_hits", "planet_checks", "planet_hits", "rule_events", "rule_ops"
+};
+
+typedef struct {
+    double phaseStart[PROFILE_PHASE_COUNT];
+    double phaseSeconds[PROFILE_PHASE_COUNT];
+    // Phase + 1 of the innermost open phase and of the one around each phase; 0 for none.
+    int openPhase;
+    int enclosingPhase[PROFILE_PHASE_COUNT];
+    long long counters[PROFILE_COUNTER_COUNT];
+    float history[PROFILE_PHASE_COUNT][PROFILE_WINDOW];
+    float frameHistory[PROFILE_WINDOW];
+    long long windowCounters[PROFILE_COUNTER_COUNT];
+    long long counterHistory[PROFILE_COUNTER_COUNT][PROFILE_WINDOW];
+    double frameStart;
+    int frame;
+    int filled;
+    FILE *csv;
+} Profiler;
+
+typedef struct {
+    float p50;
+    float p99;
+    float max;
+} ProfileStats;
+
+// One profiler per thread; the sim thread hands its phases over to the
+// render thread's profiler (see sim.h).
+static _Thread_local Profiler activeProfiler;
+
+static inline void ProfilerBegin(Profiler *profiler, int phase) {
+    profiler->enclosingPhase[phase] = profiler->openPhase;
+    profiler->openPhase = phase + 1;
+    profiler->phaseStart[phase] = TimerNowSeconds();
+}
+
+static inline void ProfilerEnd(Profiler *profiler, int phase) {
+    double seconds = TimerNowSeconds() - profiler->phaseStart[phase];
+    profiler->phaseSeconds[phase] += seconds;
+    int enclosing = profiler->enclosingPhase[phase];
+    if (enclosing > 0) profiler->phaseSeconds[enclosing - 1] -= seconds;
+    profiler->openPhase = enclosing;
+}
+
+static inline bool ProfilerOpenCsv(Profiler *profiler, const char *path) {
+    profiler->csv = fopen(path, "w");
+    if (!profiler->csv) return false;
+    fprintf(profiler->csv, "frame,frame_ms");
+    for (int i = 0; i < PROFILE_PHASE_COUNT; i++) fprintf(profiler->csv, ",%s_ms", profilePhaseNames[i]);
+    for (int i = 0; i < PROFILE_COUNTER_COUNT; i++) fprintf(profiler->csv, ",%s", profileCounterNames[i]);
+    fprintf(profiler->csv, "\n");
+    return true;
+}
+
+static inline void ProfilerCloseCsv(Profiler *profiler) {
+    if (profiler->csv) fclose(profiler->csv);
+    profiler->csv = NULL;
+}
+
+// Closes the current frame: moves the accumulated phase times and counters
+// into the rolling window and the CSV, then starts the next frame.
+static inline void ProfilerEndFrame(Profiler *profiler) {
+    double now = TimerNowSeconds();
+    float frameMilliseconds = profiler->frameStart > 0.0 ? (float)((now - profiler->frameStart) * 1e3) : 0.0f;
+    int slot = profiler->frame % PROFILE_WINDOW;
+
+    profiler->frameHistory[slot] = frameMilliseconds;
+    for (int i = 0; i < PROFILE_PHASE_COUNT; i++) profiler->history[i][slot] = (float)(profiler->phaseSeconds[i] * 1e3);
+    for (int i = 0; i < PROFILE_COUNTER_COUNT; i++) {
+        profiler->windowCounters[i] += profiler->counters[i] - profiler->counterHistory[i][slot];
+        profiler->counterHistory[i][slot] = profiler->counters[i];
+    }
+
+    if (profiler->csv) {
+        fprintf(profiler->csv, "%d,%.4f", profiler->frame, frameMilliseconds);
+        for (int i = 0; i < PROFILE_PHASE_COUNT; i++) fprintf(profiler->csv, ",%.4f", profiler->history[i][slot]);
+        for (int i = 0; i < PROFILE_COUNTER_COUNT; i++) fprintf(profiler->csv, ",%lld", profiler->counters[i]);
+        fprintf(profiler->csv, "\n");
+    }
+
+    memset(profiler->phaseSeconds, 0, sizeof(profiler->phaseSeconds));
+    memset(profiler->counters, 0, sizeof(profiler->counters));
+    profiler->frame++;
+    if (profiler->filled < PROFILE_WINDOW) profiler->filled++;
+    profiler->frameStart = now;
+}
+
+static inline int CompareFloats(const void *a, const void *b) {
+    float left = *(const float *)a, right = *(const float *)b;
+    return (left > right) - (left < right);
+}
+
+static inline ProfileStats ComputeProfileStats(const float *samples, int count) {
+    ProfileStats stats = {0};
+    if (count == 0) return stats;
+    float sorted[PROFILE_WINDOW];
+    memcpy(sorted, samples, (size_t)count * sizeof(float));
+    qsort(sorted, (size_t)count, sizeof(float), CompareFloats);
+    stats.p50 = sorted[count / 2];
+    stats.p99 = sorted[(count * 99) / 100];
+    stats.max = sorted[count - 1];
+    return stats;
+}
+
+static inline ProfileStats ProfilePhaseStats(const Profiler *profiler, int phase) {
+    return ComputeProfileStats(phase < 0 ? profiler->frameHistory : profiler->history[phase], profiler->filled);
+}
+
+#define PROFILE_BEGIN(phase) ProfilerBegin(&activeProfiler, (phase))
+#define PROFILE_END(phase) ProfilerEnd(&activeProfiler, (phase))
+#define PROFILE_COUNT(counter, amount) (activeProfiler.counters[(counter)] += (amount))
+#else
+#define PROFILE_BEGIN(phase) ((void)0)
+#define PROFILE_END(phase) ((void)0)
+#define PROFILE_COUNT(counter, amount) ((void)0)
+#endif
+
+#endif
@@ -0,0 +1,130 @@
+#ifndef PINBALL_RELOAD_H
+#define PINBALL_RELOAD_H
+
+#include "physics.h"
+#include "table.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+
+// Hot reload for editing a table while it runs. The render thread stats the
+// table file and every asset it names a few times a second and reports which
+// parts changed; the caller reloads just those between two frames. A change is
+// only reported once the file has looked the same for two polls in a row, so
+// an editor still writing it is not picked up half saved.
+
+#define RELOAD_POLL_SECONDS 0.25
+#define RELOAD_PATH_LENGTH 260
+
+#define RELOAD_TABLE (1 << 0)
+#define RELOAD_BACKGROUND (1 << 1)
+#define RELOAD_SOUND (1 << 2)
+#define RELOAD_SPRITES (1 << 3)
+
+// A missing file is a stamp too, so an asset that appears later is loaded.
+typedef struct {
+    bool exists;
+    int64_t modified;
+    int64_t size;
+} FileStamp;
+
+typedef struct {
+    char path[RELOAD_PATH_LENGTH];
+    FileStamp seen;
+    FileStamp applied;
+} FileWatch;
+
+typedef struct {
+    FileWatch table;
+    FileWatch background;
+    FileWatch sound;
+    FileWatch sprites[MAX_PLANETS];
+    int spriteCount;
+    double nextPollTime;
+} TableWatcher;
+
+static inline FileStamp ReadFileStamp(const char *path) {
+    struct stat info;
+    if (path[0] == '\0' || stat(path, &info) != 0) return (FileStamp){0};
+    return (FileStamp){true, (int64_t)info.st_mtime, (int64_t)info.st_size};
+}
+
+static inline bool SameFileStamp(FileStamp a, FileStamp b) {
+    return a.exists == b.exists && a.modified == b.modified && a.size == b.size;
+}
+
+static inline void WatchFile(FileWatch *watch, const char *path) {
+    snprintf(watch->path, sizeof(watch->path), "%s", path);
+    watch->seen = watch->applied = ReadFileStamp(watch->path);
+}
+
+static inline bool FileWatchSettled(FileWatch *watch) {
+    FileStamp stamp = ReadFileStamp(watch->path);
+    bool settled = SameFileStamp(stamp, watch->seen) && !SameFileStamp(stamp, watch->applied);
+    watch->seen = stamp;
+    if (settled) watch->applied = stamp;
+    return settled;
+}
+
+// Re-targets the asset watches at the names a (possibly new) table gives.
+static inline void WatchTableAssets(TableWatcher *watcher, const Table *table, const TableAssets *assets) {
+    WatchFile(&watcher->background, assets->background);
+    WatchFile(&watcher->sound, assets->collisionSound);
+    watcher->spriteCount = 0;
+    for (int i = 0; i < table->planetCount; i++) {
+        const char *name = assets->planetTextures[i];
+        bool seen = name[0] == '\0';
+        for (int j = 0; j < watcher->spriteCount && !seen; j++) seen = strcmp(watcher->sprites[j].path, name) == 0;
+        if (!seen) WatchFile(&watcher->sprites[watcher->spriteCount++], name);
+    }
+}
+
+static inline void StartTableWatcher(TableWatcher *watcher, const char *tablePath, const Table *table, const TableAssets *assets) {
+    memset(watcher, 0, sizeof(*watcher));
+    WatchFile(&watcher->table, tablePath);
+    WatchTableAssets(watcher, table, assets);
+}
+
+// Returns a RELOAD_* mask, or 0 between polls and while nothing changed.
+static inline int PollTableWatcher(TableWatcher *watcher, double now) {
+    if (now < watcher->nextPollTime) return 0;
+    watcher->nextPollTime = now + RELOAD_POLL_SECONDS;
+
+    int changes = 0;
+    if (FileWatchSettled(&watcher->table)) changes |= RELOAD_TABLE;
+    if (FileWatchSettled(&watcher->background)) changes |= RELOAD_BACKGROUND;
+    if (FileWatchSettled(&watcher->sound)) changes |= RELOAD_SOUND;
+    for (int i = 0; i < watcher->spriteCount; i++) {
+        if (FileWatchSettled(&watcher->sprites[i])) changes |= RELOAD_SPRITES;
+    }
+    return changes;
+}
+
+// Which assets an edited table needs reloaded. The atlas is laid out per
+// planet and sized by planet radius, so any planet change rebuilds it.
+static inline int TableAssetChanges(const Table *oldTable, const TableAssets *oldAssets,
+                                    const Table *newTable, const TableAssets *newAssets) {
+    int changes = 0;
+    if (strcmp(oldAssets->background, newAssets->background) != 0) changes |= RELOAD_BACKGROUND;
+    if (strcmp(oldAssets->collisionSound, newAssets->collisionSound) != 0) changes |= RELOAD_SOUND;
+    if (oldTable->planetCount != newTable->planetCount ||
+        memcmp(oldAssets->planetTextures, newAssets->planetTextures, sizeof(oldAssets->planetTextures)) != 0) {
+        changes |= RELOAD_SPRITES;
+    }
+    for (int i = 0; i < newTable->planetCount && !(changes & RELOAD_SPRITES); i++) {
+        if (oldTable->planets[i].radius != newTable->planets[i].radius) changes |= RELOAD_SPRITES;
+    }
+    return changes;
+}
+
+// Watched tables live on the heap, never in a mapping of the file being edited.
+static inline bool OpenWatchedTable(const char *path, TableFile *tableFile, char *error, size_t errorSize) {
+    if (!OpenTable(path, tableFile, error, errorSize)) return false;
+    if (DetachTableFile(tableFile)) return true;
+    CloseTableFile(tableFile);
+    snprintf(error, errorSize, "out of memory");
+    return false;
+}
+
+#endif
@@ -0,0 +1,214 @@
+#ifndef PINBALL_REPLAY_H
+#define PINBALL_REPLAY_H
+
+#include "physics.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Replays store the flipper input of every fixed step, run-length encoded as
+// (length << 8 | mask) words, behind a header naming the table (by hash of its
+// gameplay fields), the step settings and the starting ball. The step is
+// deterministic for a given build, so feeding the runs back reproduces the
+// final checksum bit for bit. Files are little-endian.
+
+#define REPLAY_MAGIC "PBREPLAY"
+#define REPLAY_VERSION 2u
+#define REPLAY_MAX_RUN 0xFFFFFFu
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t tableHash;
+    float fixedDeltaTime;
+    uint32_t continuousCollision;
+    int32_t multiballJackpotScore;
+    Ball initialBall;
+    uint64_t stepCount;
+    uint32_t runCount;
+    uint32_t finalChecksum;
+    int32_t finalScore;
+    uint32_t reserved;
+} ReplayHeader;
+
+typedef struct {
+    ReplayHeader header;
+    uint32_t *runs;
+    uint32_t capacity;
+} Replay;
+
+typedef struct {
+    uint32_t run;
+    uint32_t used;
+} ReplayCursor;
+
+// Step rate, swept collision and the multiball jackpot are kept out of the
+// hash and stored in the header instead, since the headless runner overrides
+// them on the command line.
+static inline uint32_t TableHash(const Table *table) {
+    uint32_t hash = 2166136261u;
+    hash = HashBytes(hash, &table->width, sizeof(float));
+    hash = HashBytes(hash, &table->height, sizeof(float));
+    hash = HashBytes(hash, &table->startPoint, sizeof(Vec2f));
+    hash = HashBytes(hash, &table->spawnPoint, sizeof(Vec2f));
+    hash = HashBytes(hash, &table->ballRadius, sizeof(float));
+    hash = HashBytes(hash, table->planets, (size_t)table->planetCount * sizeof(Planet));
+    hash = HashBytes(hash, table->segments, (size_t)table->segmentCount * sizeof(Segment));
+    for (int i = 0; i < table->flipperCount; i++) {
+        const Flipper *flipper = &table->flippers[i];
+        unsigned char isLeft = flipper->isLeftFlipper ? 1 : 0;
+        hash = HashBytes(hash, &flipper->pivotPoint, sizeof(Vec2f));
+        hash = HashBytes(hash, &flipper->length, sizeof(float));
+        hash = HashBytes(hash, &flipper->width, sizeof(float));
+        hash = HashBytes(hash, &flipper->currentAngle, sizeof(float));
+        hash = HashBytes(hash, &flipper->restingAngle, sizeof(float));
+        hash = HashBytes(hash, &flipper->activeAngle, sizeof(float));
+        hash = HashBytes(hash, &flipper->rotationSpeedDeg, sizeof(float));
+        hash = HashBytes(hash, &isLeft, 1);
+        hash = HashBytes(hash, &table->flipperBaseScore[i], sizeof(int));
+    }
+    hash = HashBytes(hash, &table->planetScore, sizeof(int));
+    // Rules drive the score, and the score triggers multiball.
+    hash = HashBytes(hash, &table->rules.size, sizeof(int32_t));
+    hash = HashBytes(hash, &table->rules.eventMask, sizeof(uint32_t));
+    hash = HashBytes(hash, table->rules.code, (size_t)table->rules.size);
+
+    const PhysicsConfig *config = &table->physics;
+    hash = HashBytes(hash, &config->gravityAcceleration, sizeof(float));
+    hash = HashBytes(hash, &config->wallBounceFactor, sizeof(float));
+    hash = HashBytes(hash, &config->planetBounceFactor, sizeof(float));
+    hash = HashBytes(hash, &config->flipperBounceFactor, sizeof(float));
+    hash = HashBytes(hash, &config->flipperImpulseStrength, sizeof(float));
+    hash = HashBytes(hash, &config->flipperVelocityTransfer, sizeof(float));
+    return hash;
+}
+
+// Replays start from a freshly reset state with a single ball.
+static inline void BeginReplayRecording(Replay *replay, const Table *table, const GameState *state) {
+    memset(replay, 0, sizeof(*replay));
+    memcpy(replay->header.magic, REPLAY_MAGIC, sizeof(replay->header.magic));
+    replay->header.version = REPLAY_VERSION;
+    replay->header.tableHash = TableHash(table);
+    replay->header.fixedDeltaTime = table->physics.fixedDeltaTime;
+    replay->header.continuousCollision = table->physics.continuousCollision ? 1u : 0u;
+    replay->header.multiballJackpotScore = table->multiballJackpotScore;
+    replay->header.initialBall = GetBall(&state->balls, 0);
+}
+
+static inline bool RecordReplayStep(Replay *replay, unsigned int inputMask) {
+    uint32_t mask = inputMask & 0xFFu;
+    ReplayHeader *header = &replay->header;
+    if (header->runCount > 0) {
+        uint32_t *last = &replay->runs[header->runCount - 1];
+        if ((*last & 0xFFu) == mask && (*last >> 8) < REPLAY_MAX_RUN) {
+            *last += 1u << 8;
+            header->stepCount++;
+            return true;
+        }
+    }
+
+    if (header->runCount == replay->capacity) {
+        uint32_t capacity = replay->capacity ? replay->capacity * 2 : 256;
+        uint32_t *runs = (uint32_t *)realloc(replay->runs, capacity * sizeof(uint32_t));
+        if (!runs) return false;
+        replay->runs = runs;
+        replay->capacity = capacity;
+    }
+    replay->runs[header->runCount++] = (1u << 8) | mask;
+    header->stepCount++;
+    return true;
+}
+
+static inline void FinishReplayRecording(Replay *replay, const GameState *state) {
+    replay->header.finalChecksum = GameStateChecksum(state);
+    replay->header.finalScore = state->score;
+}
+
+static inline bool SaveReplay(const char *path, const Replay *replay) {
+    FILE *file = fopen(path, "wb");
+    if (!file) return false;
+    bool ok = fwrite(&replay->header, sizeof(ReplayHeader), 1, file) == 1 &&
+              fwrite(replay->runs, sizeof(uint32_t), replay->header.runCount, file) == replay->header.runCount;
+    return fclose(file) == 0 && ok;
+}
+
+static inline void FreeReplay(Replay *replay) {
+    free(replay->runs);
+    memset(replay, 0, sizeof(*replay));
+}
+
+static inline bool LoadReplay(const char *path, Replay *replay, char *error, size_t errorSize) {
+    memset(replay, 0, sizeof(*replay));
+    FILE *file = fopen(path, "rb");
+    if (!file) {
+        snprintf(error, errorSize, "cannot open %s", path);
+        return false;
+    }
+
+    ReplayHeader *header = &replay->header;
+    bool ok = fread(header, sizeof(ReplayHeader), 1, file) == 1 &&
+              memcmp(header->magic, REPLAY_MAGIC, sizeof(header->magic)) == 0 &&
+              header->version == REPLAY_VERSION;
+    if (ok && header->runCount > 0) {
+        replay->runs = (uint32_t *)malloc(header->runCount * sizeof(uint32_t));
+        replay->capacity = header->runCount;
+        ok = replay->runs && fread(replay->runs, sizeof(uint32_t), header->runCount, file) == header->runCount;
+    }
+    fclose(file);
+
+    uint64_t steps = 0;
+    for (uint32_t i = 0; ok && i < header->runCount; i++) steps += replay->runs[i] >> 8;
+    if (!ok || steps != header->stepCount) {
+        snprintf(error, errorSize, "%s: not a replay or truncated", path);
+        FreeReplay(replay);
+        return false;
+    }
+    return true;
+}
+
+// Copies the recorded step settings onto a table that passed the hash check.
+static inline void ApplyReplaySettings(const Replay *replay, Table *table) {
+    table->physics.fixedDeltaTime = replay->header.fixedDeltaTime;
+    table->physics.continuousCollision = replay->header.continuousCollision != 0;
+    table->multiballJackpotScore = replay->header.multiballJackpotScore;
+}
+
+static inline bool StartReplayPlayback(const Replay *replay, const Table *table, GameState *state,
+                                       ReplayCursor *cursor, char *error, size_t errorSize) {
+    const ReplayHeader *header = &replay->header;
+    if (header->tableHash != TableHash(table)) {
+        snprintf(error, errorSize, "replay was recorded on a different table");
+        return false;
+    }
+    if (header->fixedDeltaTime != table->physics.fixedDeltaTime ||
+        (header->continuousCollision != 0) != table->physics.continuousCollision ||
+        header->multiballJackpotScore != table->multiballJackpotScore) {
+        snprintf(error, errorSize, "replay step settings do not match the table");
+        return false;
+    }
+
+    ResetGameState(table, state);
+    SetBall(&state->balls, 0, header->initialBall);
+    SaveBallPositions(&state->balls);
+    cursor->run = 0;
+    cursor->used = 0;
+    return true;
+}
+
+// Returns false once every recorded step has been handed out.
+static inline bool NextReplayInput(const Replay *replay, ReplayCursor *cursor, unsigned int *inputMask) {
+    while (cursor->run < replay->header.runCount && cursor->used >= (replay->runs[cursor->run] >> 8)) {
+        cursor->run++;
+        cursor->used = 0;
+    }
+    if (cursor->run >= replay->header.runCount) return false;
+    cursor->used++;
+    *inputMask = replay->runs[cursor->run] & 0xFFu;
+    return true;
+}
+
+static inline bool ReplayMatches(const Replay *replay, const GameState *state) {
+    return GameStateChecksum(state) == replay->header.finalChecksum && state->score == replay->header.finalScore;
+}
+
+#endif
@@ -0,0 +1,413 @@
+#ifndef PINBALL_RULES_H
+#define PINBALL_RULES_H
+
+#include <ctype.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Table scoring rules. Each table carries a small bytecode program, compiled
+// from its "rule" lines, that the step runs on every contact, drain and game
+// start. The program lives inside the Table (so binary tables map it in place)
+// and the interpreter keeps its stack in locals, so running it allocates
+// nothing. Jumps only go forward: one event executes at most RULE_MAX_CODE
+// bytes of code, whatever the rules say.
+//
+// A rule line reads
+//     rule <event>[:<index>] [when <expression>] do <target> <op> <expression>[; ...]
+// with event flipper, planet, hit (either), drain or reset, op one of
+// = += -= *=, and target score or r0..r15. Expressions are C-like integer
+// arithmetic (no assignment) over numbers and the names value, index, step,
+// score, balls and r0..r15. `value` is the contact's own worth from the table
+// (flipper score scaled by where the ball hit, or planet_score). Registers
+// start at 0 on each game and persist between events; reset rules can seed them.
+
+#define RULE_MAX_CODE 1024
+#define RULE_REGISTER_COUNT 16
+#define RULE_STACK_DEPTH 16
+#define RULE_ANY_INDEX 0xFF
+
+// Event kinds; flipper and planet match COLLIDER_FLIPPER and COLLIDER_PLANET.
+enum {
+    RULE_EVENT_HIT = 0,
+    RULE_EVENT_FLIPPER = 1,
+    RULE_EVENT_PLANET = 2,
+    RULE_EVENT_DRAIN = 3,
+    RULE_EVENT_RESET = 4
+};
+
+// Slots are the registers followed by the score and the read-only inputs.
+enum {
+    RULE_SLOT_SCORE = RULE_REGISTER_COUNT,
+    RULE_SLOT_VALUE,
+    RULE_SLOT_INDEX,
+    RULE_SLOT_STEP,
+    RULE_SLOT_BALLS
+};
+
+enum {
+    RULE_OP_EVENT,       // kind, index, u16 next rule: skip the rule unless the event matches
+    RULE_OP_SKIP_ZERO,   // u16 next rule: pop, skip the rule if zero
+    RULE_OP_PUSH,        // i32
+    RULE_OP_LOAD,        // slot
+    RULE_OP_STORE,       // slot: pop into it
+    RULE_OP_ADD, RULE_OP_SUB, RULE_OP_MUL, RULE_OP_DIV, RULE_OP_MOD,
+    RULE_OP_AND, RULE_OP_OR, RULE_OP_XOR, RULE_OP_SHL, RULE_OP_SHR,
+    RULE_OP_LT, RULE_OP_LE, RULE_OP_GT, RULE_OP_GE, RULE_OP_EQ, RULE_OP_NE,
+    RULE_OP_LOGICAL_AND, RULE_OP_LOGICAL_OR,
+    RULE_OP_NEG, RULE_OP_NOT, RULE_OP_INVERT
+};
+
+typedef struct {
+    uint8_t code[RULE_MAX_CODE];
+    int32_t size;
+    uint32_t eventMask;
+} RuleProgram;
+
+typedef struct {
+    int32_t kind;
+    int32_t index;
+    int32_t value;
+    int32_t step;
+    int32_t balls;
+} RuleEvent;
+
+// Arithmetic wraps instead of overflowing, and dividing by zero gives zero,
+// so no rule can crash the step. Returns the number of instructions run.
+static inline int RunRules(const RuleProgram *program, const RuleEvent *event, int32_t *registers, int *score) {
+    int32_t stack[RULE_STACK_DEPTH];
+    int top = 0, executed = 0;
+    const uint8_t *code = program->code;
+
+    for (int pc = 0; pc < program->size; executed++) {
+        int op = code[pc++];
+        if (op == RULE_OP_EVENT) {
+            int kind = code[pc], index = code[pc + 1];
+            int next = code[pc + 2] | code[pc + 3] << 8;
+            bool kindMatches = kind == event->kind || (kind == RULE_EVENT_HIT && event->kind <= RULE_EVENT_PLANET);
+            pc = kindMatches && (index == RULE_ANY_INDEX || index == event->index) ? pc + 4 : next;
+            top = 0;
+        } else if (op == RULE_OP_SKIP_ZERO) {
+            int next = code[pc] | code[pc + 1] << 8;
+            pc = stack[--top] != 0 ? pc + 2 : next;
+        } else if (op == RULE_OP_PUSH) {
+            uint32_t value = (uint32_t)code[pc] | (uint32_t)code[pc + 1] << 8 |
+                             (uint32_t)code[pc + 2] << 16 | (uint32_t)code[pc + 3] << 24;
+            stack[top++] = (int32_t)value;
+            pc += 4;
+        } else if (op == RULE_OP_LOAD) {
+            int slot = code[pc++];
+            stack[top++] = slot < RULE_REGISTER_COUNT ? registers[slot] :
+                           slot == RULE_SLOT_SCORE ? (int32_t)*score :
+                           slot == RULE_SLOT_VALUE ? event->value :
+                           slot == RULE_SLOT_INDEX ? event->index :
+                           slot == RULE_SLOT_STEP ? event->step : event->balls;
+        } else if (op == RULE_OP_STORE) {
+            int slot = code[pc++];
+            if (slot < RULE_REGISTER_COUNT) registers[slot] = stack[--top];
+            else *score = stack[--top];
+        } else if (op >= RULE_OP_NEG) {
+            int32_t a = stack[top - 1];
+            stack[top - 1] = op == RULE_OP_NEG ? (int32_t)(0u - (uint32_t)a) : op == RULE_OP_NOT ? !a : ~a;
+        } else {
+            int32_t b = stack[--top], a = stack[top - 1];
+            uint32_t ua = (uint32_t)a, ub = (uint32_t)b;
+            int32_t result;
+            switch (op) {
+            case RULE_OP_ADD: result = (int32_t)(ua + ub); break;
+            case RULE_OP_SUB: result = (int32_t)(ua - ub); break;
+            case RULE_OP_MUL: result = (int32_t)(ua * ub); break;
+            case RULE_OP_DIV: result = b == 0 || (b == -1 && a == INT32_MIN) ? 0 : a / b; break;
+            case RULE_OP_MOD: result = b == 0 || b == -1 ? 0 : a % b; break;
+            case RULE_OP_AND: result = a & b; break;
+            case RULE_OP_OR: result = a | b; break;
+            case RULE_OP_XOR: result = a ^ b; break;
+            case RULE_OP_SHL: result = (int32_t)(ua << (ub & 31)); break;
+            case RULE_OP_SHR: result = a >> (ub & 31); break;
+            case RULE_OP_LT: result = a < b; break;
+            case RULE_OP_LE: result = a <= b; break;
+            case RULE_OP_GT: result = a > b; break;
+            case RULE_OP_GE: result = a >= b; break;
+            case RULE_OP_EQ: result = a == b; break;
+            case RULE_OP_NE: result = a != b; break;
+            case RULE_OP_LOGICAL_AND: result = a && b; break;
+            default: result = a || b; break;
+            }
+            stack[top - 1] = result;
+        }
+    }
+    return executed;
+}
+
+// Operand bytes after an opcode, or -1 for a byte that is not one.
+static inline int RuleOperandBytes(int op) {
+    if (op == RULE_OP_EVENT || op == RULE_OP_PUSH) return 4;
+    if (op == RULE_OP_SKIP_ZERO) return 2;
+    if (op == RULE_OP_LOAD || op == RULE_OP_STORE) return 1;
+    return op <= RULE_OP_INVERT ? 0 : -1;
+}
+
+// Checks a program that did not come from CompileRule (a binary table) before
+// RunRules trusts it: known opcodes with their operands inside the code, valid
+// slots and event kinds, and jumps that go forward onto the start of a rule or
+// the end, where the stack is empty again. Walking each rule straight through
+// then gives its deepest stack, which must not underflow or pass
+// RULE_STACK_DEPTH.
+static inline bool VerifyRuleProgram(const RuleProgram *program) {
+    if (program->size < 0 || program->size > RULE_MAX_CODE) return false;
+    const uint8_t *code = program->code;
+    bool ruleStart[RULE_MAX_CODE + 1] = {false};
+    ruleStart[program->size] = true;
+    for (int pc = 0; pc < program->size;) {
+        int operands = RuleOperandBytes(code[pc]);
+        if (operands < 0 || operands > program->size - pc - 1) return false;
+        if (code[pc] == RULE_OP_EVENT) ruleStart[pc] = true;
+        pc += 1 + operands;
+    }
+
+    int depth = 0;
+    for (int pc = 0; pc < program->size;) {
+        int op = code[pc++];
+        int next = -1;
+        if (op == RULE_OP_EVENT) {
+            if (code[pc] > RULE_EVENT_RESET) return false;
+            next = code[pc + 2] | code[pc + 3] << 8;
+            depth = 0;
+        } else if (op == RULE_OP_SKIP_ZERO) {
+            next = code[pc] | code[pc + 1] << 8;
+            if (--depth < 0) return false;
+        } else if (op == RULE_OP_PUSH || op == RULE_OP_LOAD) {
+            if (op == RULE_OP_LOAD && code[pc] > RULE_SLOT_BALLS) return false;
+            if (++depth > RULE_STACK_DEPTH) return false;
+        } else if (op == RULE_OP_STORE) {
+            if (code[pc] > RULE_SLOT_SCORE || --depth < 0) return false;
+        } else if (op >= RULE_OP_NEG) {
+            if (depth < 1) return false;
+        } else if (--depth < 1) {
+            return false;
+        }
+        pc += RuleOperandBytes(op);
+        if (next >= 0 && (next < pc || next > program->size || !ruleStart[next])) return false;
+    }
+    return true;
+}
+
+// Rule compiler: a recursive descent parser emitting straight into the
+// program. A failed rule leaves the program as it was.
+typedef struct {
+    RuleProgram *program;
+    const char *cursor;
+    int depth;
+    bool failed;
+} RuleCompiler;
+
+static inline void SkipRuleSpace(RuleCompiler *compiler) {
+    while (*compiler->cursor == ' ' || *compiler->cursor == '\t') compiler->cursor++;
+}
+
+// Consumes token if it comes next; words must not run on into a longer name.
+static inline bool AcceptRuleToken(RuleCompiler *compiler, const char *token) {
+    SkipRuleSpace(compiler);
+    size_t length = strlen(token);
+    if (strncmp(compiler->cursor, token, length) != 0) return false;
+    char next = compiler->cursor[length];
+    if (isalnum((unsigned char)token[0]) && (isalnum((unsigned char)next) || next == '_')) return false;
+    compiler->cursor += length;
+    return true;
+}
+
+static inline void EmitRuleByte(RuleCompiler *compiler, int value) {
+    RuleProgram *program = compiler->program;
+    if (program->size >= RULE_MAX_CODE) {
+        compiler->failed = true;
+        return;
+    }
+    program->code[program->size++] = (uint8_t)value;
+}
+
+static inline void EmitRuleOp(RuleCompiler *compiler, int op, int stackChange) {
+    EmitRuleByte(compiler, op);
+    compiler->depth += stackChange;
+    if (compiler->depth > RULE_STACK_DEPTH) compiler->failed = true;
+}
+
+static inline void PatchRuleJump(RuleCompiler *compiler, int at) {
+    compiler->program->code[at] = (uint8_t)(compiler->program->size & 0xFF);
+    compiler->program->code[at + 1] = (uint8_t)(compiler->program->size >> 8);
+}
+
+// Slot of a name, or -1.
+static inline int ParseRuleSlot(RuleCompiler *compiler) {
+    static const char *const names[] = {"score", "value", "index", "step", "balls"};
+    for (int i = 0; i < 5; i++) {
+        if (AcceptRuleToken(compiler, names[i])) return RULE_SLOT_SCORE + i;
+    }
+    SkipRuleSpace(compiler);
+    const char *cursor = compiler->cursor;
+    if (cursor[0] != 'r' || !isdigit((unsigned char)cursor[1])) return -1;
+    char *end;
+    long slot = strtol(cursor + 1, &end, 10);
+    if (slot >= RULE_REGISTER_COUNT || isalnum((unsigned char)*end) || *end == '_') return -1;
+    compiler->cursor = end;
+    return (int)slot;
+}
+
+static inline void CompileRuleExpression(RuleCompiler *compiler, int minimumPrecedence);
+
+static inline void CompileRuleOperand(RuleCompiler *compiler) {
+    SkipRuleSpace(compiler);
+    if (AcceptRuleToken(compiler, "(")) {
+        CompileRuleExpression(compiler, 1);
+        if (!AcceptRuleToken(compiler, ")")) compiler->failed = true;
+        return;
+    }
+    if (AcceptRuleToken(compiler, "-")) {
+        CompileRuleOperand(compiler);
+        EmitRuleOp(compiler, RULE_OP_NEG, 0);
+        return;
+    }
+    if (AcceptRuleToken(compiler, "!")) {
+        CompileRuleOperand(compiler);
+        EmitRuleOp(compiler, RULE_OP_NOT, 0);
+        return;
+    }
+    if (AcceptRuleToken(compiler, "~")) {
+        CompileRuleOperand(compiler);
+        EmitRuleOp(compiler, RULE_OP_INVERT, 0);
+        return;
+    }
+    if (isdigit((unsigned char)*compiler->cursor)) {
+        char *end;
+        unsigned long value = strtoul(compiler->cursor, &end, 0);
+        compiler->cursor = end;
+        EmitRuleOp(compiler, RULE_OP_PUSH, 1);
+        for (int i = 0; i < 4; i++) EmitRuleByte(compiler, (int)(value >> (8 * i)) & 0xFF);
+        return;
+    }
+    int slot = ParseRuleSlot(compiler);
+    if (slot < 0) {
+        compiler->failed = true;
+        return;
+    }
+    EmitRuleOp(compiler, RULE_OP_LOAD, 1);
+    EmitRuleByte(compiler, slot);
+}
+
+// Binary operators by precedence, longest spelling first within a level.
+typedef struct {
+    const char *token;
+    int precedence;
+    int op;
+} RuleOperator;
+
+static const RuleOperator ruleOperators[] = {
+    {"||", 1, RULE_OP_LOGICAL_OR}, {"&&", 2, RULE_OP_LOGICAL_AND},
+    {"==", 6, RULE_OP_EQ}, {"!=", 6, RULE_OP_NE},
+    {"<<", 8, RULE_OP_SHL}, {">>", 8, RULE_OP_SHR},
+    {"<=", 7, RULE_OP_LE}, {">=", 7, RULE_OP_GE}, {"<", 7, RULE_OP_LT}, {">", 7, RULE_OP_GT},
+    {"|", 3, RULE_OP_OR}, {"^", 4, RULE_OP_XOR}, {"&", 5, RULE_OP_AND},
+    {"+", 9, RULE_OP_ADD}, {"-", 9, RULE_OP_SUB},
+    {"*", 10, RULE_OP_MUL}, {"/", 10, RULE_OP_DIV}, {"%", 10, RULE_OP_MOD}
+};
+
+static inline const RuleOperator *PeekRuleOperator(RuleCompiler *compiler) {
+    SkipRuleSpace(compiler);
+    for (size_t i = 0; i < sizeof(ruleOperators) / sizeof(ruleOperators[0]); i++) {
+        if (strncmp(compiler->cursor, ruleOperators[i].token, strlen(ruleOperators[i].token)) == 0) return &ruleOperators[i];
+    }
+    return NULL;
+}
+
+static inline void CompileRuleExpression(RuleCompiler *compiler, int minimumPrecedence) {
+    CompileRuleOperand(compiler);
+    for (const RuleOperator *op = PeekRuleOperator(compiler); op && op->precedence >= minimumPrecedence && !compiler->failed;
+         op = PeekRuleOperator(compiler)) {
+        compiler->cursor += strlen(op->token);
+        CompileRuleExpression(compiler, op->precedence + 1);
+        EmitRuleOp(compiler, op->op, -1);
+    }
+}
+
+static inline void CompileRuleAssignment(RuleCompiler *compiler) {
+    static const char *const assignments[] = {"+=", "-=", "*=", "="};
+    static const int assignmentOps[] = {RULE_OP_ADD, RULE_OP_SUB, RULE_OP_MUL, -1};
+    int slot = ParseRuleSlot(compiler);
+    if (slot < 0 || slot > RULE_SLOT_SCORE) {
+        compiler->failed = true;
+        return;
+    }
+    int kind = 0;
+    while (kind < 4 && !AcceptRuleToken(compiler, assignments[kind])) kind++;
+    if (kind == 4) {
+        compiler->failed = true;
+        return;
+    }
+    if (assignmentOps[kind] >= 0) {
+        EmitRuleOp(compiler, RULE_OP_LOAD, 1);
+        EmitRuleByte(compiler, slot);
+    }
+    CompileRuleExpression(compiler, 1);
+    if (assignmentOps[kind] >= 0) EmitRuleOp(compiler, assignmentOps[kind], -1);
+    EmitRuleOp(compiler, RULE_OP_STORE, -1);
+    EmitRuleByte(compiler, slot);
+}
+
+// Appends one rule, given as the text after the "rule" keyword.
+static inline bool CompileRule(RuleProgram *program, const char *source) {
+    static const char *const events[] = {"hit", "flipper", "planet", "drain", "reset"};
+    RuleCompiler compiler = {program, source, 0, false};
+    int32_t start = program->size;
+
+    int kind = 0;
+    while (kind < 5 && !AcceptRuleToken(&compiler, events[kind])) kind++;
+    int index = RULE_ANY_INDEX;
+    if (*compiler.cursor == ':') {
+        char *end;
+        long parsed = strtol(compiler.cursor + 1, &end, 10);
+        compiler.failed = end == compiler.cursor + 1 || parsed < 0 || parsed >= RULE_ANY_INDEX;
+        index = (int)parsed;
+        compiler.cursor = end;
+    }
+    if (kind == 5) compiler.failed = true;
+
+    EmitRuleOp(&compiler, RULE_OP_EVENT, 0);
+    EmitRuleByte(&compiler, kind);
+    EmitRuleByte(&compiler, index);
+    int eventJump = program->size;
+    EmitRuleByte(&compiler, 0);
+    EmitRuleByte(&compiler, 0);
+
+    int guardJump = -1;
+    if (AcceptRuleToken(&compiler, "when")) {
+        CompileRuleExpression(&compiler, 1);
+        EmitRuleOp(&compiler, RULE_OP_SKIP_ZERO, -1);
+        guardJump = program->size;
+        EmitRuleByte(&compiler, 0);
+        EmitRuleByte(&compiler, 0);
+    }
+    if (!AcceptRuleToken(&compiler, "do")) compiler.failed = true;
+    do {
+        if (!compiler.failed) CompileRuleAssignment(&compiler);
+    } while (!compiler.failed && AcceptRuleToken(&compiler, ";"));
+    SkipRuleSpace(&compiler);
+    if (*compiler.cursor != '\0' && *compiler.cursor != '#') compiler.failed = true;
+
+    if (compiler.failed) {
+        program->size = start;
+        return false;
+    }
+    PatchRuleJump(&compiler, eventJump);
+    if (guardJump >= 0) PatchRuleJump(&compiler, guardJump);
+    program->eventMask |= kind == RULE_EVENT_HIT ? (1u << RULE_EVENT_FLIPPER | 1u << RULE_EVENT_PLANET) : 1u << kind;
+    return true;
+}
+
+// Both collider kinds are simply worth their table value.
+static inline void InitDefaultRules(RuleProgram *program) {
+    memset(program, 0, sizeof(*program));
+    CompileRule(program, "flipper do score += value");
+    CompileRule(program, "planet do score += value");
+}
+
+#endif
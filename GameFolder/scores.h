@@ -0,0 +1,393 @@
+#ifndef PINBALL_SCORES_H
+#define PINBALL_SCORES_H
+
+#include "sim.h"
+#include "thread.h"
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// Game results and session telemetry, kept across runs. Every record is
+// appended to a log and never rewritten. Each record is framed by a magic
+// word, its type and size, and a CRC of all three plus the payload, so a
+// record torn by a crash is skipped when the log is read back and the reader
+// resyncs on the next magic. The top scores also live in a small index next
+// to the log. The index is replaced by writing a temporary file and renaming
+// it over the old one, so it is always either the previous or the new
+// version; an index that is missing or does not check out is rebuilt from
+// the log. The index remembers how much of the log it covers, so startup only
+// scans records appended after the last index write.
+//
+// The render thread queues records and a background thread writes them, so a
+// slow disk never stalls a frame; a full queue drops the record. Files are
+// little-endian, like replays.
+
+#define SCORE_LOG_MAGIC 0x474C4250u
+#define SCORE_INDEX_MAGIC "PBSCORES"
+#define SCORE_INDEX_VERSION 1u
+#define SCORE_LEADERBOARD_SIZE 32
+#define SCORE_QUEUE_CAPACITY 64
+#define SCORE_MAX_RECORD_BYTES 4096
+#define SCORE_WRITER_POLL_SECONDS 0.05
+#define SCORE_PATH_MAX 512
+
+enum {
+    SCORE_RECORD_GAME = 1,
+    SCORE_RECORD_SESSION = 2
+};
+
+enum {
+    SCORE_DRAIN_LEFT = 0,
+    SCORE_DRAIN_CENTER = 1,
+    SCORE_DRAIN_RIGHT = 2
+};
+
+typedef struct {
+    uint32_t magic;
+    uint32_t type;
+    uint32_t size;
+    uint32_t crc;
+} ScoreRecordHeader;
+
+// Frame times of the render loop over the span of a game or a session.
+typedef struct {
+    uint32_t frames;
+    uint32_t slowFrames;
+    float meanMilliseconds;
+    float maxMilliseconds;
+} FrameSummary;
+
+// Payload of SCORE_RECORD_GAME, followed by colliderCount ColliderHits.
+typedef struct {
+    int64_t endTime;
+    int32_t score;
+    uint32_t steps;
+    float stepSeconds;
+    uint32_t drainSide;
+    int32_t peakBalls;
+    int32_t multiballs;
+    uint32_t tableHash;
+    FrameSummary frames;
+    uint32_t colliderCount;
+} GameLogRecord;
+
+// Payload of SCORE_RECORD_SESSION, written once on exit.
+typedef struct {
+    int64_t startTime;
+    int64_t endTime;
+    uint32_t games;
+    uint32_t droppedRecords;
+    FrameSummary frames;
+} SessionLogRecord;
+
+typedef struct {
+    int32_t score;
+    uint32_t steps;
+    int64_t endTime;
+} ScoreEntry;
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t count;
+    uint64_t logBytes;
+    uint32_t crc;
+    uint32_t reserved;
+} ScoreIndexHeader;
+
+typedef struct {
+    ScoreEntry entries[SCORE_LEADERBOARD_SIZE];
+    int count;
+    uint64_t logBytes;
+} Leaderboard;
+
+typedef struct {
+    uint32_t type;
+    uint32_t size;
+    unsigned char payload[sizeof(GameLogRecord) + SIM_MAX_RESULT_COLLIDERS * sizeof(ColliderHits)];
+} QueuedScoreRecord;
+
+typedef struct {
+    char logPath[SCORE_PATH_MAX];
+    char indexPath[SCORE_PATH_MAX];
+    char temporaryPath[SCORE_PATH_MAX];
+
+    // Render thread side.
+    int bestScore;
+    unsigned int dropped;
+
+    QueuedScoreRecord queue[SCORE_QUEUE_CAPACITY];
+    atomic_uint writeIndex;
+    atomic_uint readIndex;
+
+    // Writer thread side once started.
+    Leaderboard leaderboard;
+    FILE *log;
+    bool writeFailed;
+
+    atomic_bool quit;
+    Thread thread;
+} ScoreStore;
+
+static inline uint32_t Crc32(uint32_t crc, const void *data, size_t size) {
+    const unsigned char *bytes = (const unsigned char *)data;
+    crc = ~crc;
+    for (size_t i = 0; i < size; i++) {
+        crc ^= bytes[i];
+        for (int bit = 0; bit < 8; bit++) crc = (crc >> 1) ^ (0xEDB88320u & (0u - (crc & 1u)));
+    }
+    return ~crc;
+}
+
+static inline uint32_t ScoreRecordCrc(uint32_t type, uint32_t size, const void *payload) {
+    uint32_t crc = Crc32(0, &type, sizeof(type));
+    crc = Crc32(crc, &size, sizeof(size));
+    return Crc32(crc, payload, size);
+}
+
+static inline void AddLeaderboardEntry(Leaderboard *leaderboard, ScoreEntry entry) {
+    int position = leaderboard->count;
+    while (position > 0 && leaderboard->entries[position - 1].score < entry.score) position--;
+    if (position >= SCORE_LEADERBOARD_SIZE) return;
+    int moved = (leaderboard->count < SCORE_LEADERBOARD_SIZE ? leaderboard->count : SCORE_LEADERBOARD_SIZE - 1) - position;
+    memmove(&leaderboard->entries[position + 1], &leaderboard->entries[position], (size_t)moved * sizeof(ScoreEntry));
+    leaderboard->entries[position] = entry;
+    if (leaderboard->count < SCORE_LEADERBOARD_SIZE) leaderboard->count++;
+}
+
+static inline bool LoadScoreIndex(const char *path, Leaderboard *leaderboard) {
+    memset(leaderboard, 0, sizeof(*leaderboard));
+    FILE *file = fopen(path, "rb");
+    if (!file) return false;
+    ScoreIndexHeader header;
+    ScoreEntry entries[SCORE_LEADERBOARD_SIZE];
+    bool ok = fread(&header, sizeof(header), 1, file) == 1 &&
+              memcmp(header.magic, SCORE_INDEX_MAGIC, sizeof(header.magic)) == 0 &&
+              header.version == SCORE_INDEX_VERSION && header.count <= SCORE_LEADERBOARD_SIZE &&
+              fread(entries, sizeof(ScoreEntry), header.count, file) == header.count;
+    fclose(file);
+    uint32_t storedCrc = ok ? header.crc : 0;
+    if (ok) {
+        header.crc = 0;
+        ok = Crc32(Crc32(0, &header, sizeof(header)), entries, header.count * sizeof(ScoreEntry)) == storedCrc;
+    }
+    if (!ok) return false;
+    memcpy(leaderboard->entries, entries, header.count * sizeof(ScoreEntry));
+    leaderboard->count = (int)header.count;
+    leaderboard->logBytes = header.logBytes;
+    return true;
+}
+
+#if defined(_WIN32)
+// Declared by hand so this header can sit next to raylib.h without windows.h.
+__declspec(dllimport) int __stdcall MoveFileExA(const char *existingName, const char *newName, unsigned long flags);
+
+static inline bool ReplaceFile(const char *from, const char *to) {
+    // MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH
+    return MoveFileExA(from, to, 0x1ul | 0x8ul) != 0;
+}
+#else
+static inline bool ReplaceFile(const char *from, const char *to) {
+    return rename(from, to) == 0;
+}
+#endif
+
+static inline bool SaveScoreIndex(const char *path, const char *temporaryPath, const Leaderboard *leaderboard) {
+    ScoreIndexHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, SCORE_INDEX_MAGIC, sizeof(header.magic));
+    header.version = SCORE_INDEX_VERSION;
+    header.count = (uint32_t)leaderboard->count;
+    header.logBytes = leaderboard->logBytes;
+    header.crc = Crc32(Crc32(0, &header, sizeof(header)), leaderboard->entries, header.count * sizeof(ScoreEntry));
+
+    FILE *file = fopen(temporaryPath, "wb");
+    if (!file) return false;
+    bool ok = fwrite(&header, sizeof(header), 1, file) == 1 &&
+              fwrite(leaderboard->entries, sizeof(ScoreEntry), header.count, file) == header.count;
+    ok = fclose(file) == 0 && ok;
+    if (!ok) {
+        remove(temporaryPath);
+        return false;
+    }
+    return ReplaceFile(temporaryPath, path);
+}
+
+// Folds every intact game record from the given offset on into the
+// leaderboard and returns the log size. Damaged stretches are skipped a byte
+// at a time until the next record that checks out.
+static inline uint64_t ScanScoreLog(const char *path, uint64_t offset, Leaderboard *leaderboard) {
+    FILE *file = fopen(path, "rb");
+    if (!file) return 0;
+    static unsigned char payload[SCORE_MAX_RECORD_BYTES];
+    uint64_t position = offset;
+    while (fseek(file, (long)position, SEEK_SET) == 0) {
+        ScoreRecordHeader header;
+        if (fread(&header, sizeof(header), 1, file) != 1) break;
+        bool intact = header.magic == SCORE_LOG_MAGIC && header.size <= SCORE_MAX_RECORD_BYTES &&
+                      fread(payload, 1, header.size, file) == header.size &&
+                      ScoreRecordCrc(header.type, header.size, payload) == header.crc;
+        if (!intact) {
+            position++;
+            continue;
+        }
+        if (header.type == SCORE_RECORD_GAME && header.size >= sizeof(GameLogRecord)) {
+            GameLogRecord game;
+            memcpy(&game, payload, sizeof(game));
+            AddLeaderboardEntry(leaderboard, (ScoreEntry){game.score, game.steps, game.endTime});
+        }
+        position += sizeof(header) + header.size;
+    }
+    fseek(file, 0, SEEK_END);
+    uint64_t size = (uint64_t)ftell(file);
+    fclose(file);
+    return size;
+}
+
+static inline bool PushScoreRecord(ScoreStore *store, uint32_t type, const void *payload, uint32_t size) {
+    unsigned int writeIndex = atomic_load_explicit(&store->writeIndex, memory_order_relaxed);
+    if (writeIndex - atomic_load_explicit(&store->readIndex, memory_order_acquire) >= SCORE_QUEUE_CAPACITY ||
+        size > sizeof(store->queue[0].payload)) {
+        store->dropped++;
+        return false;
+    }
+    QueuedScoreRecord *record = &store->queue[writeIndex % SCORE_QUEUE_CAPACITY];
+    record->type = type;
+    record->size = size;
+    memcpy(record->payload, payload, size);
+    atomic_store_explicit(&store->writeIndex, writeIndex + 1, memory_order_release);
+    return true;
+}
+
+static inline void WriteScoreRecord(ScoreStore *store, const QueuedScoreRecord *record) {
+    ScoreRecordHeader header = {SCORE_LOG_MAGIC, record->type, record->size,
+                                ScoreRecordCrc(record->type, record->size, record->payload)};
+    bool ok = store->log && fwrite(&header, sizeof(header), 1, store->log) == 1 &&
+              fwrite(record->payload, 1, record->size, store->log) == record->size && fflush(store->log) == 0;
+    if (!ok) {
+        store->writeFailed = true;
+        return;
+    }
+    store->leaderboard.logBytes += sizeof(header) + record->size;
+    if (record->type == SCORE_RECORD_GAME) {
+        GameLogRecord game;
+        memcpy(&game, record->payload, sizeof(game));
+        AddLeaderboardEntry(&store->leaderboard, (ScoreEntry){game.score, game.steps, game.endTime});
+    }
+}
+
+static inline int ScoreWriterMain(void *argument) {
+    ScoreStore *store = (ScoreStore *)argument;
+    for (;;) {
+        bool quitting = atomic_load(&store->quit);
+        unsigned int readIndex = atomic_load_explicit(&store->readIndex, memory_order_relaxed);
+        unsigned int writeIndex = atomic_load_explicit(&store->writeIndex, memory_order_acquire);
+        for (; readIndex != writeIndex; readIndex++) WriteScoreRecord(store, &store->queue[readIndex % SCORE_QUEUE_CAPACITY]);
+        bool wrote = readIndex != atomic_load_explicit(&store->readIndex, memory_order_relaxed);
+        atomic_store_explicit(&store->readIndex, readIndex, memory_order_release);
+        // The log is flushed first, so an index never covers bytes the log lacks.
+        if (wrote && !store->writeFailed) SaveScoreIndex(store->indexPath, store->temporaryPath, &store->leaderboard);
+        if (quitting) break;
+        ThreadSleepSeconds(SCORE_WRITER_POLL_SECONDS);
+    }
+    return 0;
+}
+
+// Loads the leaderboard and starts the writer. On failure the store still
+// takes records and just drops them.
+static inline bool OpenScoreStore(ScoreStore *store, const char *logPath) {
+    memset(store, 0, sizeof(*store));
+    atomic_init(&store->writeIndex, 0);
+    atomic_init(&store->readIndex, 0);
+    atomic_init(&store->quit, false);
+    snprintf(store->logPath, sizeof(store->logPath), "%s", logPath);
+    snprintf(store->indexPath, sizeof(store->indexPath), "%s.idx", logPath);
+    snprintf(store->temporaryPath, sizeof(store->temporaryPath), "%s.idx.tmp", logPath);
+
+    Leaderboard *leaderboard = &store->leaderboard;
+    bool indexed = LoadScoreIndex(store->indexPath, leaderboard);
+    uint64_t logBytes = ScanScoreLog(store->logPath, indexed ? leaderboard->logBytes : 0, leaderboard);
+    if (indexed && logBytes < leaderboard->logBytes) {
+        // The log was replaced under the index.
+        memset(leaderboard, 0, sizeof(*leaderboard));
+        logBytes = ScanScoreLog(store->logPath, 0, leaderboard);
+        indexed = false;
+    }
+    bool stale = !indexed || logBytes != leaderboard->logBytes;
+    leaderboard->logBytes = logBytes;
+    store->bestScore = leaderboard->count > 0 ? leaderboard->entries[0].score : 0;
+
+    store->log = fopen(store->logPath, "ab");
+    if (!store->log) return false;
+    if (stale) SaveScoreIndex(store->indexPath, store->temporaryPath, leaderboard);
+    if (!ThreadStart(&store->thread, ScoreWriterMain, store)) {
+        fclose(store->log);
+        store->log = NULL;
+        return false;
+    }
+    return true;
+}
+
+// Lets the writer drain the queue, then stops it.
+static inline void CloseScoreStore(ScoreStore *store) {
+    if (!store->log) return;
+    atomic_store(&store->quit, true);
+    ThreadJoin(store->thread);
+    fclose(store->log);
+    store->log = NULL;
+}
+
+static inline void SubmitGameResult(ScoreStore *store, const Table *table, const GameResult *result, const FrameSummary *frames) {
+    unsigned char payload[sizeof(GameLogRecord) + SIM_MAX_RESULT_COLLIDERS * sizeof(ColliderHits)];
+    GameLogRecord game;
+    memset(&game, 0, sizeof(game));
+    game.endTime = (int64_t)time(NULL);
+    game.score = result->score;
+    game.steps = result->steps;
+    game.stepSeconds = table->physics.fixedDeltaTime;
+    game.drainSide = result->drainX < table->width / 3.0f ? SCORE_DRAIN_LEFT :
+                     result->drainX > table->width * 2.0f / 3.0f ? SCORE_DRAIN_RIGHT : SCORE_DRAIN_CENTER;
+    game.peakBalls = result->peakBalls;
+    game.multiballs = result->multiballs;
+    game.tableHash = TableHash(table);
+    game.frames = *frames;
+    game.colliderCount = (uint32_t)result->colliderCount;
+    memcpy(payload, &game, sizeof(game));
+    memcpy(payload + sizeof(game), result->colliders, game.colliderCount * sizeof(ColliderHits));
+    if (PushScoreRecord(store, SCORE_RECORD_GAME, payload, (uint32_t)(sizeof(game) + game.colliderCount * sizeof(ColliderHits))) &&
+        result->score > store->bestScore) {
+        store->bestScore = result->score;
+    }
+}
+
+static inline void SubmitSessionSummary(ScoreStore *store, int64_t startTime, uint32_t games, const FrameSummary *frames) {
+    SessionLogRecord session = {startTime, (int64_t)time(NULL), games, store->dropped, *frames};
+    PushScoreRecord(store, SCORE_RECORD_SESSION, &session, sizeof(session));
+}
+
+// Accumulates render frame times for a FrameSummary.
+typedef struct {
+    uint32_t frames;
+    uint32_t slowFrames;
+    double totalSeconds;
+    double maxSeconds;
+} FrameTally;
+
+static inline void TallyFrame(FrameTally *tally, double seconds, double slowSeconds) {
+    tally->frames++;
+    tally->totalSeconds += seconds;
+    if (seconds > tally->maxSeconds) tally->maxSeconds = seconds;
+    if (seconds > slowSeconds) tally->slowFrames++;
+}
+
+static inline FrameSummary SummariseFrames(const FrameTally *tally) {
+    FrameSummary summary = {tally->frames, tally->slowFrames, 0.0f, (float)(tally->maxSeconds * 1000.0)};
+    if (tally->frames > 0) summary.meanMilliseconds = (float)(tally->totalSeconds * 1000.0 / tally->frames);
+    return summary;
+}
+
+#endif
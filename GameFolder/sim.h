@@ -0,0 +1,523 @@
+#ifndef PINBALL_SIM_H
+#define PINBALL_SIM_H
+
+#include "physics.h"
+#include "events.h"
+#include "profiler.h"
+#include "replay.h"
+#include "thread.h"
+#include "timer.h"
+#include <stdatomic.h>
+#include <string.h>
+
+// Runs the physics step on its own thread, paced against the wall clock at
+// the table's fixed rate, so a stalled frame no longer holds back physics or
+// input. The render thread sends flipper input as timestamped events; each
+// event takes effect from the first step scheduled at or after its
+// timestamp. The sim hands finished states back through a lock-free triple
+// buffer of snapshots. The sim thread is the only producer of collision
+// events and the only writer of the game state and replay while it runs.
+// Once nothing has moved for a while the thread wakes at frame rate instead
+// of step rate and runs the due steps in a batch; the steps and their input
+// timing are unchanged, only the wakeups are fewer.
+//
+// Two optional links feed the network code. Every finished step can be copied
+// into a StepRecordRing for a consumer on another thread, and a StepInputQueue
+// can replace local input with one mask per step from a remote player. A sim
+// fed that way runs in lockstep with the queue: it stalls when the next mask
+// has not arrived and catches up quickly once masks pile up.
+//
+// The sim also keeps a tally of the game in progress and hands a GameResult
+// to the render thread, through another ring, whenever the last ball drains.
+
+#define SIM_MAX_SNAPSHOT_BALLS 16
+#define SIM_INPUT_QUEUE_CAPACITY 256
+#define SIM_MAX_CATCH_UP_STEPS 64
+#define SIM_SPIN_SECONDS 0.0005
+#define SIM_SNAPSHOT_FRESH 4
+#define SIM_REST_DISTANCE 0.01f
+#define SIM_REST_STEPS 360
+#define SIM_REST_WAKE_SECONDS (1.0 / 60.0)
+#define SIM_STEP_RECORD_CAPACITY 256
+#define SIM_STEP_INPUT_CAPACITY 4096
+#define SIM_LOCKSTEP_MAX_BACKLOG 8
+#define SIM_GAME_RESULT_CAPACITY 16
+#define SIM_MAX_RESULT_COLLIDERS 64
+
+typedef struct {
+    int ballCount;
+    float x[SIM_MAX_SNAPSHOT_BALLS];
+    float y[SIM_MAX_SNAPSHOT_BALLS];
+    float previousX[SIM_MAX_SNAPSHOT_BALLS];
+    float previousY[SIM_MAX_SNAPSHOT_BALLS];
+    float radius[SIM_MAX_SNAPSHOT_BALLS];
+    FlipperPose flipperPoses[MAX_FLIPPERS];
+    FlipperPose previousFlipperPoses[MAX_FLIPPERS];
+    int score;
+    uint64_t stepCount;
+    double stepEndTime;
+    bool replayFinished;
+    bool replayMatched;
+    bool atRest;
+} SimSnapshot;
+
+// slots[back] is written by the sim, slots[front] read by the renderer and the
+// remaining slot is parked in `middle`, tagged SIM_SNAPSHOT_FRESH when it holds
+// a snapshot the renderer has not picked up yet.
+typedef struct {
+    SimSnapshot slots[3];
+    atomic_int middle;
+    int back;
+    int front;
+} SnapshotTripleBuffer;
+
+typedef struct {
+    double time;
+    unsigned int inputMask;
+} InputEvent;
+
+typedef struct {
+    InputEvent events[SIM_INPUT_QUEUE_CAPACITY];
+    atomic_uint writeIndex;
+    atomic_uint readIndex;
+} InputEventQueue;
+
+// The part of a finished step that is worth replicating.
+typedef struct {
+    uint64_t step;
+    unsigned int inputMask;
+    int score;
+    int ballCount;
+    float x[SIM_MAX_SNAPSHOT_BALLS];
+    float y[SIM_MAX_SNAPSHOT_BALLS];
+    float radius[SIM_MAX_SNAPSHOT_BALLS];
+    float flipperAngles[MAX_FLIPPERS];
+} StepRecord;
+
+// Single producer (the sim), single consumer. A full ring drops the record.
+typedef struct {
+    StepRecord records[SIM_STEP_RECORD_CAPACITY];
+    atomic_uint writeIndex;
+    atomic_uint readIndex;
+    unsigned int dropped;
+} StepRecordRing;
+
+typedef struct {
+    unsigned char masks[SIM_STEP_INPUT_CAPACITY];
+    atomic_uint writeIndex;
+    atomic_uint readIndex;
+} StepInputQueue;
+
+static inline void InitStepRecordRing(StepRecordRing *ring) {
+    atomic_init(&ring->writeIndex, 0);
+    atomic_init(&ring->readIndex, 0);
+    ring->dropped = 0;
+}
+
+static inline bool PopStepRecord(StepRecordRing *ring, StepRecord *record) {
+    unsigned int readIndex = atomic_load_explicit(&ring->readIndex, memory_order_relaxed);
+    if (readIndex == atomic_load_explicit(&ring->writeIndex, memory_order_acquire)) return false;
+    *record = ring->records[readIndex % SIM_STEP_RECORD_CAPACITY];
+    atomic_store_explicit(&ring->readIndex, readIndex + 1, memory_order_release);
+    return true;
+}
+
+static inline void InitStepInputQueue(StepInputQueue *queue) {
+    atomic_init(&queue->writeIndex, 0);
+    atomic_init(&queue->readIndex, 0);
+}
+
+static inline bool PushStepInput(StepInputQueue *queue, unsigned int inputMask) {
+    unsigned int writeIndex = atomic_load_explicit(&queue->writeIndex, memory_order_relaxed);
+    if (writeIndex - atomic_load_explicit(&queue->readIndex, memory_order_acquire) >= SIM_STEP_INPUT_CAPACITY) return false;
+    queue->masks[writeIndex % SIM_STEP_INPUT_CAPACITY] = (unsigned char)inputMask;
+    atomic_store_explicit(&queue->writeIndex, writeIndex + 1, memory_order_release);
+    return true;
+}
+
+static inline unsigned int StepInputBacklog(StepInputQueue *queue) {
+    return atomic_load_explicit(&queue->writeIndex, memory_order_acquire) -
+           atomic_load_explicit(&queue->readIndex, memory_order_relaxed);
+}
+
+static inline unsigned int PopStepInput(StepInputQueue *queue) {
+    unsigned int readIndex = atomic_load_explicit(&queue->readIndex, memory_order_relaxed);
+    unsigned int inputMask = queue->masks[readIndex % SIM_STEP_INPUT_CAPACITY];
+    atomic_store_explicit(&queue->readIndex, readIndex + 1, memory_order_release);
+    return inputMask;
+}
+
+typedef struct {
+    uint8_t colliderKind;
+    uint8_t reserved;
+    uint16_t colliderIndex;
+    uint32_t hits;
+} ColliderHits;
+
+// One finished game. Steps counts from the first step of the game to the
+// drain of its last ball. Colliders that were never hit are left out.
+typedef struct {
+    uint64_t endStep;
+    uint32_t steps;
+    int32_t score;
+    float drainX;
+    int32_t peakBalls;
+    int32_t multiballs;
+    int32_t colliderCount;
+    ColliderHits colliders[SIM_MAX_RESULT_COLLIDERS];
+} GameResult;
+
+typedef struct {
+    GameResult results[SIM_GAME_RESULT_CAPACITY];
+    atomic_uint writeIndex;
+    atomic_uint readIndex;
+} GameResultRing;
+
+typedef struct {
+    uint64_t startStep;
+    int peakBalls;
+    int multiballs;
+    int nextJackpotScore;
+    uint32_t flipperHits[MAX_FLIPPERS];
+    uint32_t planetHits[MAX_PLANETS];
+} GameTally;
+
+static inline bool PopGameResult(GameResultRing *ring, GameResult *result) {
+    unsigned int readIndex = atomic_load_explicit(&ring->readIndex, memory_order_relaxed);
+    if (readIndex == atomic_load_explicit(&ring->writeIndex, memory_order_acquire)) return false;
+    *result = ring->results[readIndex % SIM_GAME_RESULT_CAPACITY];
+    atomic_store_explicit(&ring->readIndex, readIndex + 1, memory_order_release);
+    return true;
+}
+
+typedef struct {
+    const Table *table;
+    GameState *state;
+    CollisionEventQueue *collisionEvents;
+    Replay *replay;
+    ReplayCursor *replayCursor;
+    bool replaying;
+    bool recording;
+    int speed;
+    StepRecordRing *stepOutput;
+    StepInputQueue *stepInput;
+
+    InputEventQueue input;
+    SnapshotTripleBuffer snapshots;
+    unsigned int inputMask;
+    bool replayFinished;
+    FlipperPose previousFlipperPoses[MAX_FLIPPERS];
+    double nextStepTime;
+    int restSteps;
+    unsigned int restInput;
+    GameTally tally;
+    GameResultRing gameResults;
+
+    atomic_bool quit;
+    Thread thread;
+#if defined(PINBALL_PROFILE)
+    // Phase time and counters handed to the render thread's profiler.
+    atomic_llong profileNanoseconds[PROFILE_PHASE_COUNT];
+    atomic_llong profileCounters[PROFILE_COUNTER_COUNT];
+#endif
+} Simulation;
+
+static inline bool PushInputEvent(Simulation *sim, double time, unsigned int inputMask) {
+    InputEventQueue *queue = &sim->input;
+    unsigned int writeIndex = atomic_load_explicit(&queue->writeIndex, memory_order_relaxed);
+    if (writeIndex - atomic_load_explicit(&queue->readIndex, memory_order_acquire) >= SIM_INPUT_QUEUE_CAPACITY) return false;
+    queue->events[writeIndex % SIM_INPUT_QUEUE_CAPACITY] = (InputEvent){time, inputMask};
+    atomic_store_explicit(&queue->writeIndex, writeIndex + 1, memory_order_release);
+    return true;
+}
+
+// Applies every queued event stamped at or before the given step time.
+static inline void ApplyInputEvents(Simulation *sim, double stepTime) {
+    InputEventQueue *queue = &sim->input;
+    unsigned int readIndex = atomic_load_explicit(&queue->readIndex, memory_order_relaxed);
+    unsigned int writeIndex = atomic_load_explicit(&queue->writeIndex, memory_order_acquire);
+    while (readIndex != writeIndex) {
+        const InputEvent *event = &queue->events[readIndex % SIM_INPUT_QUEUE_CAPACITY];
+        if (event->time > stepTime) break;
+        sim->inputMask = event->inputMask;
+        readIndex++;
+    }
+    atomic_store_explicit(&queue->readIndex, readIndex, memory_order_release);
+}
+
+static inline bool SimulationAtRest(const Simulation *sim) {
+    return sim->restSteps >= SIM_REST_STEPS || sim->replayFinished;
+}
+
+// Wall-clock time of one step at the sim's playback speed.
+static inline double SimulationStepSeconds(const Simulation *sim) {
+    return (double)sim->table->physics.fixedDeltaTime / (double)sim->speed;
+}
+
+static inline void FillSnapshot(const Simulation *sim, SimSnapshot *snapshot) {
+    const GameState *state = sim->state;
+    const BallBatch *balls = &state->balls;
+
+    snapshot->ballCount = balls->count < SIM_MAX_SNAPSHOT_BALLS ? balls->count : SIM_MAX_SNAPSHOT_BALLS;
+    size_t ballBytes = (size_t)snapshot->ballCount * sizeof(float);
+    memcpy(snapshot->x, balls->x, ballBytes);
+    memcpy(snapshot->y, balls->y, ballBytes);
+    memcpy(snapshot->previousX, balls->previousX, ballBytes);
+    memcpy(snapshot->previousY, balls->previousY, ballBytes);
+    memcpy(snapshot->radius, balls->radius, ballBytes);
+    memcpy(snapshot->flipperPoses, state->flipperPoses, sizeof(snapshot->flipperPoses));
+    memcpy(snapshot->previousFlipperPoses, sim->previousFlipperPoses, sizeof(snapshot->previousFlipperPoses));
+    snapshot->score = state->score;
+    snapshot->stepCount = state->stepCount;
+    // nextStepTime already points at the step that has not run yet.
+    snapshot->stepEndTime = sim->nextStepTime - SimulationStepSeconds(sim);
+    snapshot->replayFinished = sim->replayFinished;
+    snapshot->replayMatched = sim->replayFinished && ReplayMatches(sim->replay, state);
+    snapshot->atRest = SimulationAtRest(sim);
+}
+
+static inline void PublishSnapshot(Simulation *sim) {
+    SnapshotTripleBuffer *buffer = &sim->snapshots;
+    FillSnapshot(sim, &buffer->slots[buffer->back]);
+    int previous = atomic_exchange(&buffer->middle, buffer->back | SIM_SNAPSHOT_FRESH);
+    buffer->back = previous & 3;
+}
+
+// Returns the newest published snapshot; the same one again when nothing new
+// arrived since the last call.
+static inline const SimSnapshot *AcquireSnapshot(Simulation *sim) {
+    SnapshotTripleBuffer *buffer = &sim->snapshots;
+    if (atomic_load(&buffer->middle) & SIM_SNAPSHOT_FRESH) {
+        int previous = atomic_exchange(&buffer->middle, buffer->front);
+        buffer->front = previous & 3;
+    }
+    return &buffer->slots[buffer->front];
+}
+
+static inline void PushStepRecord(StepRecordRing *ring, const GameState *state, int flipperCount, unsigned int inputMask) {
+    unsigned int writeIndex = atomic_load_explicit(&ring->writeIndex, memory_order_relaxed);
+    if (writeIndex - atomic_load_explicit(&ring->readIndex, memory_order_acquire) >= SIM_STEP_RECORD_CAPACITY) {
+        ring->dropped++;
+        return;
+    }
+    StepRecord *record = &ring->records[writeIndex % SIM_STEP_RECORD_CAPACITY];
+    const BallBatch *balls = &state->balls;
+    record->step = state->stepCount;
+    record->inputMask = inputMask;
+    record->score = state->score;
+    record->ballCount = balls->count < SIM_MAX_SNAPSHOT_BALLS ? balls->count : SIM_MAX_SNAPSHOT_BALLS;
+    size_t ballBytes = (size_t)record->ballCount * sizeof(float);
+    memcpy(record->x, balls->x, ballBytes);
+    memcpy(record->y, balls->y, ballBytes);
+    memcpy(record->radius, balls->radius, ballBytes);
+    for (int i = 0; i < flipperCount; i++) record->flipperAngles[i] = state->flippers[i].currentAngle;
+    atomic_store_explicit(&ring->writeIndex, writeIndex + 1, memory_order_release);
+}
+
+static inline void AppendColliderHits(GameResult *result, int colliderKind, const uint32_t *hits, int count) {
+    for (int i = 0; i < count && result->colliderCount < SIM_MAX_RESULT_COLLIDERS; i++) {
+        if (hits[i] == 0) continue;
+        result->colliders[result->colliderCount++] = (ColliderHits){(uint8_t)colliderKind, 0, (uint16_t)i, hits[i]};
+    }
+}
+
+// A full ring drops the result; the render thread drains it every frame.
+static inline void FinishTalliedGame(Simulation *sim) {
+    GameResultRing *ring = &sim->gameResults;
+    const GameState *state = sim->state;
+    unsigned int writeIndex = atomic_load_explicit(&ring->writeIndex, memory_order_relaxed);
+    if (writeIndex - atomic_load_explicit(&ring->readIndex, memory_order_acquire) < SIM_GAME_RESULT_CAPACITY) {
+        GameResult *result = &ring->results[writeIndex % SIM_GAME_RESULT_CAPACITY];
+        result->endStep = state->stepCount;
+        result->steps = (uint32_t)(state->stepCount - sim->tally.startStep);
+        result->score = state->lastGameScore;
+        result->drainX = state->lastDrainX;
+        result->peakBalls = sim->tally.peakBalls;
+        result->multiballs = sim->tally.multiballs;
+        result->colliderCount = 0;
+        AppendColliderHits(result, COLLIDER_FLIPPER, sim->tally.flipperHits, sim->table->flipperCount);
+        AppendColliderHits(result, COLLIDER_PLANET, sim->tally.planetHits, sim->table->planetCount);
+        atomic_store_explicit(&ring->writeIndex, writeIndex + 1, memory_order_release);
+    }
+    memset(&sim->tally, 0, sizeof(sim->tally));
+    sim->tally.startStep = state->stepCount;
+    sim->tally.nextJackpotScore = state->nextJackpotScore;
+}
+
+static inline void TallyStep(Simulation *sim, int stepEvents) {
+    const GameState *state = sim->state;
+    GameTally *tally = &sim->tally;
+    for (int i = 0; i < state->stepEventCount; i++) {
+        const CollisionEvent *event = &state->stepEvents[i];
+        if (event->colliderKind == COLLIDER_FLIPPER && event->colliderIndex < MAX_FLIPPERS) tally->flipperHits[event->colliderIndex]++;
+        if (event->colliderKind == COLLIDER_PLANET && event->colliderIndex < MAX_PLANETS) tally->planetHits[event->colliderIndex]++;
+    }
+    if (state->balls.count > tally->peakBalls) tally->peakBalls = state->balls.count;
+    // Each launch raises the jackpot threshold; the game over reset lowers it.
+    if (state->nextJackpotScore > tally->nextJackpotScore) tally->multiballs++;
+    tally->nextJackpotScore = state->nextJackpotScore;
+    if (stepEvents & STEP_EVENT_GAME_OVER) FinishTalliedGame(sim);
+}
+
+static inline void RunSimulationStep(Simulation *sim) {
+    const Table *table = sim->table;
+    GameState *state = sim->state;
+
+    unsigned int stepInput = sim->stepInput ? PopStepInput(sim->stepInput) : sim->inputMask;
+    if (sim->replaying && !NextReplayInput(sim->replay, sim->replayCursor, &stepInput)) {
+        sim->replayFinished = true;
+        return;
+    }
+    if (sim->recording) RecordReplayStep(sim->replay, stepInput);
+
+    SaveBallPositions(&state->balls);
+    memcpy(sim->previousFlipperPoses, state->flipperPoses, sizeof(sim->previousFlipperPoses));
+    int stepEvents = StepPhysics(table, state, stepInput);
+    TallyStep(sim, stepEvents);
+    PublishStepEvents(sim->collisionEvents, state);
+    if (sim->stepOutput) PushStepRecord(sim->stepOutput, state, table->flipperCount, stepInput);
+
+    const BallBatch *balls = &state->balls;
+    float moved = 0.0f;
+    for (int i = 0; i < balls->count; i++) {
+        moved = fmaxf(moved, fabsf(balls->x[i] - balls->previousX[i]) + fabsf(balls->y[i] - balls->previousY[i]));
+    }
+    bool still = moved < SIM_REST_DISTANCE && stepInput == sim->restInput;
+    sim->restSteps = still ? sim->restSteps + 1 : 0;
+    sim->restInput = stepInput;
+}
+
+#if defined(PINBALL_PROFILE)
+static inline void HandOverSimulationProfile(Simulation *sim) {
+    for (int i = 0; i < PROFILE_PHASE_COUNT; i++) {
+        atomic_fetch_add(&sim->profileNanoseconds[i], (long long)(activeProfiler.phaseSeconds[i] * 1e9));
+        activeProfiler.phaseSeconds[i] = 0.0;
+    }
+    for (int i = 0; i < PROFILE_COUNTER_COUNT; i++) {
+        atomic_fetch_add(&sim->profileCounters[i], activeProfiler.counters[i]);
+        activeProfiler.counters[i] = 0;
+    }
+}
+
+// Render thread side: folds the sim's phases into the frame being profiled.
+static inline void AbsorbSimulationProfile(Simulation *sim, Profiler *profiler) {
+    for (int i = 0; i < PROFILE_PHASE_COUNT; i++) {
+        profiler->phaseSeconds[i] += (double)atomic_exchange(&sim->profileNanoseconds[i], 0) * 1e-9;
+    }
+    for (int i = 0; i < PROFILE_COUNTER_COUNT; i++) {
+        profiler->counters[i] += atomic_exchange(&sim->profileCounters[i], 0);
+    }
+}
+#endif
+
+static inline int SimulationThreadMain(void *argument) {
+    Simulation *sim = (Simulation *)argument;
+    const double stepSeconds = SimulationStepSeconds(sim);
+    sim->nextStepTime = TimerNowSeconds() + stepSeconds;
+
+    while (!atomic_load(&sim->quit)) {
+        double now = TimerNowSeconds();
+        int steps = 0;
+        while (!sim->replayFinished) {
+            // A lockstep sim waits for the remote mask, and runs ahead of the
+            // clock while masks are piling up.
+            if (sim->stepInput) {
+                unsigned int backlog = StepInputBacklog(sim->stepInput);
+                if (backlog == 0) {
+                    if (sim->nextStepTime <= now) sim->nextStepTime = now + stepSeconds;
+                    break;
+                }
+                if (sim->nextStepTime > now && backlog <= SIM_LOCKSTEP_MAX_BACKLOG) break;
+            } else if (sim->nextStepTime > now) {
+                break;
+            }
+            ApplyInputEvents(sim, sim->nextStepTime - stepSeconds);
+            RunSimulationStep(sim);
+            sim->nextStepTime += stepSeconds;
+            if (sim->stepInput && sim->nextStepTime > now + stepSeconds) sim->nextStepTime = now + stepSeconds;
+
+            // After a long stall, skip ahead instead of fast-forwarding.
+            if (++steps >= SIM_MAX_CATCH_UP_STEPS) {
+                sim->nextStepTime = now + stepSeconds;
+                break;
+            }
+        }
+        if (steps > 0) {
+            PublishSnapshot(sim);
+#if defined(PINBALL_PROFILE)
+            HandOverSimulationProfile(sim);
+#endif
+        }
+        if (sim->replayFinished) sim->nextStepTime = now + stepSeconds;
+
+        double wakeTime = sim->nextStepTime;
+        if (SimulationAtRest(sim)) wakeTime += SIM_REST_WAKE_SECONDS;
+        double remaining = wakeTime - TimerNowSeconds();
+        if (remaining > SIM_SPIN_SECONDS) ThreadSleepSeconds(remaining - SIM_SPIN_SECONDS);
+    }
+    return 0;
+}
+
+// Every slot starts out holding the current state.
+static inline void ResetSnapshots(Simulation *sim) {
+    FillSnapshot(sim, &sim->snapshots.slots[0]);
+    sim->snapshots.slots[1] = sim->snapshots.slots[2] = sim->snapshots.slots[0];
+    atomic_init(&sim->snapshots.middle, 1);
+    sim->snapshots.back = 0;
+    sim->snapshots.front = 2;
+}
+
+// The caller keeps ownership of state, queues and replay, and must not touch
+// them until StopSimulation returns. stepOutput and stepInput may be NULL.
+static inline bool StartSimulation(Simulation *sim, const Table *table, GameState *state, CollisionEventQueue *collisionEvents,
+                                   Replay *replay, ReplayCursor *replayCursor, bool replaying, bool recording, int speed,
+                                   StepRecordRing *stepOutput, StepInputQueue *stepInput) {
+    memset(sim, 0, sizeof(*sim));
+    sim->table = table;
+    sim->state = state;
+    sim->collisionEvents = collisionEvents;
+    sim->replay = replay;
+    sim->replayCursor = replayCursor;
+    sim->replaying = replaying;
+    sim->recording = recording;
+    sim->speed = speed > 0 ? speed : 1;
+    sim->stepOutput = stepOutput;
+    sim->stepInput = stepInput;
+    memcpy(sim->previousFlipperPoses, state->flipperPoses, sizeof(sim->previousFlipperPoses));
+
+    atomic_init(&sim->input.writeIndex, 0);
+    atomic_init(&sim->input.readIndex, 0);
+    atomic_init(&sim->quit, false);
+    atomic_init(&sim->gameResults.writeIndex, 0);
+    atomic_init(&sim->gameResults.readIndex, 0);
+    sim->tally.startStep = state->stepCount;
+    sim->tally.nextJackpotScore = state->nextJackpotScore;
+#if defined(PINBALL_PROFILE)
+    for (int i = 0; i < PROFILE_PHASE_COUNT; i++) atomic_init(&sim->profileNanoseconds[i], 0);
+    for (int i = 0; i < PROFILE_COUNTER_COUNT; i++) atomic_init(&sim->profileCounters[i], 0);
+#endif
+
+    sim->nextStepTime = TimerNowSeconds();
+    ResetSnapshots(sim);
+
+    return ThreadStart(&sim->thread, SimulationThreadMain, sim);
+}
+
+static inline void StopSimulation(Simulation *sim) {
+    atomic_store(&sim->quit, true);
+    ThreadJoin(sim->thread);
+}
+
+// Restarts a stopped simulation on another table, e.g. after a hot reload
+// rebound the state to it. Queued input, the game tally and undrained results
+// carry over, so a game in progress keeps counting across the swap.
+static inline bool ResumeSimulation(Simulation *sim, const Table *table) {
+    sim->table = table;
+    memcpy(sim->previousFlipperPoses, sim->state->flipperPoses, sizeof(sim->previousFlipperPoses));
+    sim->nextStepTime = TimerNowSeconds();
+    ResetSnapshots(sim);
+    atomic_store(&sim->quit, false);
+    return ThreadStart(&sim->thread, SimulationThreadMain, sim);
+}
+
+#endif
@@ -0,0 +1,73 @@
+#ifndef PINBALL_SIMD_H
+#define PINBALL_SIMD_H
+
+#include <stdint.h>
+
+// Narrow-phase circle tests against SIMD_LANES circles at once. Inputs are
+// structure-of-arrays lanes; the result has bit i set when circle i overlaps
+// the ball, using squared distances only.
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#define SIMD_LANES 8
+#define SIMD_KERNEL_NAME "avx"
+
+static inline uint32_t CircleOverlapMask(const float *centerX, const float *centerY, const float *radius,
+                                         float ballX, float ballY, float ballRadius) {
+    __m256 deltaX = _mm256_sub_ps(_mm256_loadu_ps(centerX), _mm256_set1_ps(ballX));
+    __m256 deltaY = _mm256_sub_ps(_mm256_loadu_ps(centerY), _mm256_set1_ps(ballY));
+    __m256 reach = _mm256_add_ps(_mm256_loadu_ps(radius), _mm256_set1_ps(ballRadius));
+    __m256 distanceSquared = _mm256_add_ps(_mm256_mul_ps(deltaX, deltaX), _mm256_mul_ps(deltaY, deltaY));
+    __m256 overlap = _mm256_cmp_ps(distanceSquared, _mm256_mul_ps(reach, reach), _CMP_LT_OQ);
+    return (uint32_t)_mm256_movemask_ps(overlap);
+}
+
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define SIMD_LANES 4
+#define SIMD_KERNEL_NAME "sse2"
+
+static inline uint32_t CircleOverlapMask(const float *centerX, const float *centerY, const float *radius,
+                                         float ballX, float ballY, float ballRadius) {
+    __m128 deltaX = _mm_sub_ps(_mm_loadu_ps(centerX), _mm_set1_ps(ballX));
+    __m128 deltaY = _mm_sub_ps(_mm_loadu_ps(centerY), _mm_set1_ps(ballY));
+    __m128 reach = _mm_add_ps(_mm_loadu_ps(radius), _mm_set1_ps(ballRadius));
+    __m128 distanceSquared = _mm_add_ps(_mm_mul_ps(deltaX, deltaX), _mm_mul_ps(deltaY, deltaY));
+    __m128 overlap = _mm_cmplt_ps(distanceSquared, _mm_mul_ps(reach, reach));
+    return (uint32_t)_mm_movemask_ps(overlap);
+}
+
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#define SIMD_LANES 4
+#define SIMD_KERNEL_NAME "neon"
+
+static inline uint32_t CircleOverlapMask(const float *centerX, const float *centerY, const float *radius,
+                                         float ballX, float ballY, float ballRadius) {
+    static const uint32_t laneBits[4] = {1, 2, 4, 8};
+    float32x4_t deltaX = vsubq_f32(vld1q_f32(centerX), vdupq_n_f32(ballX));
+    float32x4_t deltaY = vsubq_f32(vld1q_f32(centerY), vdupq_n_f32(ballY));
+    float32x4_t reach = vaddq_f32(vld1q_f32(radius), vdupq_n_f32(ballRadius));
+    float32x4_t distanceSquared = vmlaq_f32(vmulq_f32(deltaX, deltaX), deltaY, deltaY);
+    uint32x4_t overlap = vcltq_f32(distanceSquared, vmulq_f32(reach, reach));
+    return vaddvq_u32(vandq_u32(overlap, vld1q_u32(laneBits)));
+}
+
+#else
+#define SIMD_LANES 4
+#define SIMD_KERNEL_NAME "scalar"
+
+static inline uint32_t CircleOverlapMask(const float *centerX, const float *centerY, const float *radius,
+                                         float ballX, float ballY, float ballRadius) {
+    uint32_t mask = 0;
+    for (int lane = 0; lane < SIMD_LANES; lane++) {
+        float deltaX = centerX[lane] - ballX;
+        float deltaY = centerY[lane] - ballY;
+        float reach = radius[lane] + ballRadius;
+        if (deltaX * deltaX + deltaY * deltaY < reach * reach) mask |= 1u << lane;
+    }
+    return mask;
+}
+#endif
+
+#endif
@@ -0,0 +1,397 @@
+#ifndef PINBALL_TABLE_H
+#define PINBALL_TABLE_H
+
+#include "physics.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Table descriptions come in two flavours:
+//  * text (.table): one directive per line, '#' starts a comment.
+//  * binary (.tbin): a header followed by the ready-to-use Table and
+//    TableAssets structs, grid included. It is mapped and used in place, so
+//    it is tied to the build that wrote it (checked through its header).
+
+#define TABLE_NAME_LENGTH 64
+#define TABLE_LINE_LENGTH 4096
+#define TABLE_BINARY_MAGIC "PBTABLE"
+#define TABLE_BINARY_VERSION 3u
+#define TABLE_ARC_PIECE_LENGTH 8.0f
+
+typedef struct {
+    char background[TABLE_NAME_LENGTH];
+    char collisionSound[TABLE_NAME_LENGTH];
+    char planetTextures[MAX_PLANETS][TABLE_NAME_LENGTH];
+} TableAssets;
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t tableSize;
+    uint32_t assetsSize;
+    uint32_t checksum;
+    uint32_t reserved[2];
+} TableFileHeader;
+
+typedef struct {
+    void *data;
+    size_t size;
+    bool mapped;
+    const Table *table;
+    const TableAssets *assets;
+} TableFile;
+
+static inline void InitDefaultTableAssets(TableAssets *assets) {
+    static const char *planetTextures[] = {"earth.png", "mars.png", "jup.png", "nep.png", "uranus.png", "venus.png"};
+    memset(assets, 0, sizeof(*assets));
+    snprintf(assets->background, TABLE_NAME_LENGTH, "%s", "spacebg.jpg");
+    snprintf(assets->collisionSound, TABLE_NAME_LENGTH, "%s", "hit.wav");
+    for (int i = 0; i < 6; i++) snprintf(assets->planetTextures[i], TABLE_NAME_LENGTH, "%s", planetTextures[i]);
+}
+
+static inline bool AddTableSegment(Table *table, Vec2f start, Vec2f end) {
+    if (table->segmentCount >= MAX_SEGMENTS) return false;
+    table->segments[table->segmentCount++] = (Segment){start, end};
+    return true;
+}
+
+// Curved walls are stored as chords about TABLE_ARC_PIECE_LENGTH long; the
+// wall field smooths over the joints.
+static inline bool AddTableArc(Table *table, float centerX, float centerY, float radius, float startDeg, float endDeg) {
+    if (radius <= 0.0f) return false;
+    float sweep = (endDeg - startDeg) * DEG2RAD;
+    int pieces = (int)ceilf(fabsf(sweep) * radius / TABLE_ARC_PIECE_LENGTH);
+    if (pieces < 1) pieces = 1;
+    Vec2f previous = {centerX + radius * cosf(startDeg * DEG2RAD), centerY + radius * sinf(startDeg * DEG2RAD)};
+    for (int i = 1; i <= pieces; i++) {
+        float angle = startDeg * DEG2RAD + sweep * (float)i / (float)pieces;
+        Vec2f point = {centerX + radius * cosf(angle), centerY + radius * sinf(angle)};
+        if (!AddTableSegment(table, previous, point)) return false;
+        previous = point;
+    }
+    return true;
+}
+
+static inline bool AddTablePolyline(Table *table, const char *points) {
+    Vec2f previous, point;
+    int consumed, count = 0;
+    while (sscanf(points, "%f %f%n", &point.x, &point.y, &consumed) == 2) {
+        if (count++ > 0 && !AddTableSegment(table, previous, point)) return false;
+        previous = point;
+        points += consumed;
+    }
+    while (*points == ' ' || *points == '\t') points++;
+    return count >= 2 && *points == '\0';
+}
+
+static inline bool ParseTableLine(const char *line, Table *table, TableAssets *assets) {
+    char key[32], name[TABLE_NAME_LENGTH], side[16];
+    float a, b, c, d, e, f, g;
+    int score;
+
+    if (sscanf(line, "%31s", key) != 1 || key[0] == '#') return true;
+
+    if (strcmp(key, "size") == 0) return sscanf(line, "%*s %f %f", &table->width, &table->height) == 2;
+    if (strcmp(key, "start") == 0) return sscanf(line, "%*s %f %f", &table->startPoint.x, &table->startPoint.y) == 2;
+    if (strcmp(key, "spawn") == 0) return sscanf(line, "%*s %f %f", &table->spawnPoint.x, &table->spawnPoint.y) == 2;
+    if (strcmp(key, "ball_radius") == 0) return sscanf(line, "%*s %f", &table->ballRadius) == 1;
+    if (strcmp(key, "gravity") == 0) return sscanf(line, "%*s %f", &table->physics.gravityAcceleration) == 1;
+    if (strcmp(key, "wall_bounce") == 0) return sscanf(line, "%*s %f", &table->physics.wallBounceFactor) == 1;
+    if (strcmp(key, "planet_bounce") == 0) return sscanf(line, "%*s %f", &table->physics.planetBounceFactor) == 1;
+    if (strcmp(key, "flipper_bounce") == 0) return sscanf(line, "%*s %f", &table->physics.flipperBounceFactor) == 1;
+    if (strcmp(key, "flipper_impulse") == 0) return sscanf(line, "%*s %f", &table->physics.flipperImpulseStrength) == 1;
+    if (strcmp(key, "flipper_transfer") == 0) return sscanf(line, "%*s %f", &table->physics.flipperVelocityTransfer) == 1;
+    if (strcmp(key, "planet_score") == 0) return sscanf(line, "%*s %d", &table->planetScore) == 1;
+    if (strcmp(key, "multiball_jackpot") == 0) return sscanf(line, "%*s %d", &table->multiballJackpotScore) == 1;
+
+    if (strcmp(key, "step_rate") == 0) {
+        if (sscanf(line, "%*s %f", &a) != 1 || a <= 0.0f) return false;
+        table->physics.fixedDeltaTime = 1.0f / a;
+        return true;
+    }
+    if (strcmp(key, "ccd") == 0) {
+        if (sscanf(line, "%*s %d", &score) != 1) return false;
+        table->physics.continuousCollision = score != 0;
+        return true;
+    }
+    if (strcmp(key, "rule") == 0) {
+        int offset = 0;
+        sscanf(line, "%*s%n", &offset);
+        return CompileRule(&table->rules, line + offset);
+    }
+    if (strcmp(key, "background") == 0) return sscanf(line, "%*s %63s", assets->background) == 1;
+    if (strcmp(key, "sound") == 0) return sscanf(line, "%*s %63s", assets->collisionSound) == 1;
+
+    if (strcmp(key, "planet") == 0) {
+        if (table->planetCount >= MAX_PLANETS) return false;
+        name[0] = '\0';
+        if (sscanf(line, "%*s %f %f %f %63s", &a, &b, &c, name) < 3) return false;
+        snprintf(assets->planetTextures[table->planetCount], TABLE_NAME_LENGTH, "%s", name);
+        table->planets[table->planetCount++] = (Planet){a, b, c};
+        return true;
+    }
+    if (strcmp(key, "segment") == 0) {
+        if (sscanf(line, "%*s %f %f %f %f", &a, &b, &c, &d) != 4) return false;
+        return AddTableSegment(table, (Vec2f){a, b}, (Vec2f){c, d});
+    }
+    if (strcmp(key, "arc") == 0) {
+        if (sscanf(line, "%*s %f %f %f %f %f", &a, &b, &c, &d, &e) != 5) return false;
+        return AddTableArc(table, a, b, c, d, e);
+    }
+    if (strcmp(key, "polyline") == 0) {
+        int offset = 0;
+        sscanf(line, "%*s%n", &offset);
+        return AddTablePolyline(table, line + offset);
+    }
+    if (strcmp(key, "flipper") == 0) {
+        if (table->flipperCount >= MAX_FLIPPERS) return false;
+        if (sscanf(line, "%*s %15s %f %f %f %f %f %f %f %d", side, &a, &b, &c, &d, &e, &f, &g, &score) != 9) return false;
+        if (strcmp(side, "left") != 0 && strcmp(side, "right") != 0) return false;
+        int index = table->flipperCount++;
+        table->flippers[index] = (Flipper){{a, b}, c, d, e * DEG2RAD, e * DEG2RAD, f * DEG2RAD, g, strcmp(side, "left") == 0};
+        table->flipperBaseScore[index] = score;
+        return true;
+    }
+    return false;
+}
+
+// Parses a text table. Values not mentioned keep the built-in defaults, and a
+// table with no planet, segment, flipper or rule lines gets the default list of
+// that kind.
+static inline bool LoadTableText(const char *path, Table *table, TableAssets *assets, char *error, size_t errorSize) {
+    FILE *file = fopen(path, "r");
+    if (!file) {
+        snprintf(error, errorSize, "cannot open %s", path);
+        return false;
+    }
+
+    InitDefaultTable(table);
+    InitDefaultTableAssets(assets);
+    table->planetCount = table->segmentCount = table->flipperCount = 0;
+    memset(assets->planetTextures, 0, sizeof(assets->planetTextures));
+    memset(&table->rules, 0, sizeof(table->rules));
+
+    char line[TABLE_LINE_LENGTH];
+    int lineNumber = 0;
+    bool ok = true;
+    while (ok && fgets(line, sizeof(line), file)) {
+        lineNumber++;
+        // fgets splits a longer line, and both halves would parse as nonsense.
+        if (!strchr(line, '\n') && !feof(file)) {
+            snprintf(error, errorSize, "%.160s:%d: line too long (over %d characters)", path, lineNumber,
+                     TABLE_LINE_LENGTH - 2);
+            ok = false;
+            break;
+        }
+        line[strcspn(line, "\r\n")] = '\0';
+        if (!ParseTableLine(line, table, assets)) {
+            snprintf(error, errorSize, "%.160s:%d: bad line: %.60s", path, lineNumber, line);
+            ok = false;
+        }
+    }
+    fclose(file);
+    if (!ok) return false;
+
+    if (table->rules.size == 0) InitDefaultRules(&table->rules);
+    if (table->planetCount == 0 || table->segmentCount == 0 || table->flipperCount == 0) {
+        Table *defaults = (Table *)malloc(sizeof(Table));
+        TableAssets *defaultAssets = (TableAssets *)malloc(sizeof(TableAssets));
+        if (!defaults || !defaultAssets) {
+            free(defaults);
+            free(defaultAssets);
+            snprintf(error, errorSize, "out of memory");
+            return false;
+        }
+        InitDefaultTable(defaults);
+        InitDefaultTableAssets(defaultAssets);
+        if (table->planetCount == 0) {
+            table->planetCount = defaults->planetCount;
+            memcpy(table->planets, defaults->planets, sizeof(table->planets));
+            memcpy(assets->planetTextures, defaultAssets->planetTextures, sizeof(assets->planetTextures));
+        }
+        if (table->segmentCount == 0) {
+            table->segmentCount = defaults->segmentCount;
+            memcpy(table->segments, defaults->segments, sizeof(table->segments));
+        }
+        if (table->flipperCount == 0) {
+            table->flipperCount = defaults->flipperCount;
+            memcpy(table->flippers, defaults->flippers, sizeof(table->flippers));
+            memcpy(table->flipperBaseScore, defaults->flipperBaseScore, sizeof(table->flipperBaseScore));
+        }
+        free(defaults);
+        free(defaultAssets);
+    }
+    BuildCollisionGrid(table);
+    return true;
+}
+
+static inline bool SaveTableBinary(const char *path, const Table *table, const TableAssets *assets) {
+    TableFileHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, TABLE_BINARY_MAGIC, sizeof(TABLE_BINARY_MAGIC));
+    header.version = TABLE_BINARY_VERSION;
+    header.tableSize = (uint32_t)sizeof(Table);
+    header.assetsSize = (uint32_t)sizeof(TableAssets);
+    header.checksum = HashBytes(HashBytes(2166136261u, table, sizeof(Table)), assets, sizeof(TableAssets));
+
+    FILE *file = fopen(path, "wb");
+    if (!file) return false;
+    bool ok = fwrite(&header, sizeof(header), 1, file) == 1 &&
+              fwrite(table, sizeof(Table), 1, file) == 1 &&
+              fwrite(assets, sizeof(TableAssets), 1, file) == 1;
+    return (fclose(file) == 0) && ok;
+}
+
+static inline void CloseTableFile(TableFile *tableFile) {
+#if !defined(_WIN32)
+    if (tableFile->mapped) {
+        munmap(tableFile->data, tableFile->size);
+        memset(tableFile, 0, sizeof(*tableFile));
+        return;
+    }
+#endif
+    free(tableFile->data);
+    memset(tableFile, 0, sizeof(*tableFile));
+}
+
+// Maps a binary table. POSIX builds use mmap; elsewhere the file is read into
+// one buffer, which is still used without any parsing.
+// A binary table is used in place, so whatever indexes an array or drives the
+// rule interpreter is checked once here rather than trusted on every step.
+static inline bool TableWithinLimits(const Table *table) {
+    return table->planetCount >= 0 && table->planetCount <= MAX_PLANETS &&
+           table->segmentCount >= 0 && table->segmentCount <= MAX_SEGMENTS &&
+           table->flipperCount >= 0 && table->flipperCount <= MAX_FLIPPERS &&
+           VerifyRuleProgram(&table->rules);
+}
+
+static inline bool OpenTableBinary(const char *path, TableFile *tableFile) {
+    memset(tableFile, 0, sizeof(*tableFile));
+    size_t expectedSize = sizeof(TableFileHeader) + sizeof(Table) + sizeof(TableAssets);
+
+#if !defined(_WIN32)
+    int descriptor = open(path, O_RDONLY);
+    if (descriptor < 0) return false;
+    struct stat info;
+    if (fstat(descriptor, &info) != 0 || (size_t)info.st_size != expectedSize) {
+        close(descriptor);
+        return false;
+    }
+    void *data = mmap(NULL, expectedSize, PROT_READ, MAP_PRIVATE, descriptor, 0);
+    close(descriptor);
+    if (data == MAP_FAILED) return false;
+    tableFile->mapped = true;
+#else
+    FILE *file = fopen(path, "rb");
+    if (!file) return false;
+    void *data = malloc(expectedSize);
+    bool readOk = data && fread(data, 1, expectedSize, file) == expectedSize && fgetc(file) == EOF;
+    fclose(file);
+    if (!readOk) {
+        free(data);
+        return false;
+    }
+#endif
+    tableFile->data = data;
+    tableFile->size = expectedSize;
+
+    const TableFileHeader *header = (const TableFileHeader *)data;
+    const unsigned char *payload = (const unsigned char *)data + sizeof(TableFileHeader);
+    if (memcmp(header->magic, TABLE_BINARY_MAGIC, sizeof(TABLE_BINARY_MAGIC)) != 0 ||
+        header->version != TABLE_BINARY_VERSION ||
+        header->tableSize != sizeof(Table) || header->assetsSize != sizeof(TableAssets) ||
+        header->checksum != HashBytes(2166136261u, payload, sizeof(Table) + sizeof(TableAssets)) ||
+        !TableWithinLimits((const Table *)payload)) {
+        CloseTableFile(tableFile);
+        return false;
+    }
+
+    tableFile->table = (const Table *)payload;
+    tableFile->assets = (const TableAssets *)(payload + sizeof(Table));
+    return true;
+}
+
+// Copies a mapped binary table onto the heap. Rewriting a file that is still
+// mapped (e.g. tablec recompiling a watched table) truncates it under the
+// mapping, and the next read of the table would fault.
+static inline bool DetachTableFile(TableFile *tableFile) {
+    if (!tableFile->mapped) return true;
+    void *data = malloc(tableFile->size);
+    if (!data) return false;
+    memcpy(data, tableFile->data, tableFile->size);
+    size_t tableOffset = (size_t)((const unsigned char *)tableFile->table - (const unsigned char *)tableFile->data);
+    size_t assetsOffset = (size_t)((const unsigned char *)tableFile->assets - (const unsigned char *)tableFile->data);
+    size_t size = tableFile->size;
+    CloseTableFile(tableFile);
+    tableFile->data = data;
+    tableFile->size = size;
+    tableFile->table = (const Table *)((unsigned char *)data + tableOffset);
+    tableFile->assets = (const TableAssets *)((unsigned char *)data + assetsOffset);
+    return true;
+}
+
+static inline bool HasExtension(const char *path, const char *extension) {
+    size_t pathLength = strlen(path), extensionLength = strlen(extension);
+    return pathLength >= extensionLength && strcmp(path + pathLength - extensionLength, extension) == 0;
+}
+
+static inline bool OpenTableData(const char *path, TableFile *tableFile, char *error, size_t errorSize) {
+    if (HasExtension(path, ".tbin")) {
+        if (OpenTableBinary(path, tableFile)) return true;
+        snprintf(error, errorSize, "%s: missing, corrupt or written by a different build", path);
+        return false;
+    }
+
+    memset(tableFile, 0, sizeof(*tableFile));
+    size_t size = sizeof(Table) + sizeof(TableAssets);
+    unsigned char *data = (unsigned char *)malloc(size);
+    if (!data) {
+        snprintf(error, errorSize, "out of memory");
+        return false;
+    }
+    if (!LoadTableText(path, (Table *)data, (TableAssets *)(data + sizeof(Table)), error, errorSize)) {
+        free(data);
+        return false;
+    }
+    tableFile->data = data;
+    tableFile->size = size;
+    tableFile->table = (const Table *)data;
+    tableFile->assets = (const TableAssets *)(data + sizeof(Table));
+    return true;
+}
+
+// Opens either flavour. Text tables are parsed into a heap copy so callers can
+// treat both the same way through tableFile->table. Builds with a fixed physics
+// profile only accept tables that use exactly that profile.
+static inline bool OpenTable(const char *path, TableFile *tableFile, char *error, size_t errorSize) {
+    if (!OpenTableData(path, tableFile, error, errorSize)) return false;
+    if (!PhysicsMatchesProfile(&tableFile->table->physics)) {
+        snprintf(error, errorSize, "%s: physics settings differ from this build's fixed profile", path);
+        CloseTableFile(tableFile);
+        return false;
+    }
+    return true;
+}
+
+// Falls back to the built-in table when nothing could be loaded.
+static inline void OpenDefaultTable(TableFile *tableFile) {
+    memset(tableFile, 0, sizeof(*tableFile));
+    size_t size = sizeof(Table) + sizeof(TableAssets);
+    unsigned char *data = (unsigned char *)malloc(size);
+    if (!data) abort();
+    InitDefaultTable((Table *)data);
+    InitDefaultTableAssets((TableAssets *)(data + sizeof(Table)));
+    tableFile->data = data;
+    tableFile->size = size;
+    tableFile->table = (const Table *)data;
+    tableFile->assets = (const TableAssets *)(data + sizeof(Table));
+}
+
+#endif
@@ -0,0 +1,27 @@
+#include "table.h"
+#include <stdio.h>
+
+int main(int argc, char **argv) {
+    if (argc != 3) {
+        fprintf(stderr, "usage: %s input.table output.tbin\n", argv[0]);
+        return 1;
+    }
+
+    static Table table;
+    static TableAssets assets;
+    char error[256];
+    if (!LoadTableText(argv[1], &table, &assets, error, sizeof(error))) {
+        fprintf(stderr, "%s\n", error);
+        return 1;
+    }
+    if (!SaveTableBinary(argv[2], &table, &assets)) {
+        fprintf(stderr, "cannot write %s\n", argv[2]);
+        return 1;
+    }
+
+    printf("%s: %d planets, %d segments, %d flippers, grid %dx%d, wall field %dx%d at %.1f (%zu bytes)\n", argv[2],
+           table.planetCount, table.segmentCount, table.flipperCount, table.grid.columns, table.grid.rows,
+           table.walls.columns, table.walls.rows, table.walls.cellSize,
+           sizeof(TableFileHeader) + sizeof(Table) + sizeof(TableAssets));
+    return 0;
+}
@@ -0,0 +1,111 @@
+#ifndef PINBALL_THREAD_H
+#define PINBALL_THREAD_H
+
+#include <stdbool.h>
+#include <stdlib.h>
+
+// Minimal thread wrapper. Win32 entry points are declared by hand, like in
+// timer.h, so this can be included next to raylib.h without windows.h, and
+// MinGW builds need no extra pthread library.
+
+typedef int (*ThreadFunction)(void *argument);
+
+#if defined(_WIN32)
+#include <process.h>
+
+__declspec(dllimport) unsigned long __stdcall WaitForSingleObject(void *handle, unsigned long milliseconds);
+__declspec(dllimport) int __stdcall CloseHandle(void *handle);
+__declspec(dllimport) void __stdcall Sleep(unsigned long milliseconds);
+
+typedef struct {
+    void *handle;
+} Thread;
+
+typedef struct {
+    ThreadFunction function;
+    void *argument;
+} ThreadStartInfo;
+
+static unsigned __stdcall ThreadTrampoline(void *startInfo) {
+    ThreadStartInfo info = *(ThreadStartInfo *)startInfo;
+    free(startInfo);
+    return (unsigned)info.function(info.argument);
+}
+
+static inline bool ThreadStart(Thread *thread, ThreadFunction function, void *argument) {
+    ThreadStartInfo *info = (ThreadStartInfo *)malloc(sizeof(ThreadStartInfo));
+    if (!info) return false;
+    info->function = function;
+    info->argument = argument;
+    thread->handle = (void *)_beginthreadex(NULL, 0, ThreadTrampoline, info, 0, NULL);
+    if (!thread->handle) free(info);
+    return thread->handle != NULL;
+}
+
+static inline void ThreadJoin(Thread thread) {
+    WaitForSingleObject(thread.handle, 0xFFFFFFFFul);
+    CloseHandle(thread.handle);
+}
+
+static inline void ThreadSleepSeconds(double seconds) {
+    Sleep(seconds > 0.0 ? (unsigned long)(seconds * 1000.0) : 0);
+}
+
+static inline int ThreadHardwareConcurrency(void) {
+    const char *count = getenv("NUMBER_OF_PROCESSORS");
+    int value = count ? atoi(count) : 1;
+    return value > 0 ? value : 1;
+}
+
+#else
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+
+typedef struct {
+    pthread_t handle;
+} Thread;
+
+typedef struct {
+    ThreadFunction function;
+    void *argument;
+} ThreadStartInfo;
+
+static void *ThreadTrampoline(void *startInfo) {
+    ThreadStartInfo info = *(ThreadStartInfo *)startInfo;
+    free(startInfo);
+    info.function(info.argument);
+    return NULL;
+}
+
+static inline bool ThreadStart(Thread *thread, ThreadFunction function, void *argument) {
+    ThreadStartInfo *info = (ThreadStartInfo *)malloc(sizeof(ThreadStartInfo));
+    if (!info) return false;
+    info->function = function;
+    info->argument = argument;
+    if (pthread_create(&thread->handle, NULL, ThreadTrampoline, info) != 0) {
+        free(info);
+        return false;
+    }
+    return true;
+}
+
+static inline void ThreadJoin(Thread thread) {
+    pthread_join(thread.handle, NULL);
+}
+
+static inline void ThreadSleepSeconds(double seconds) {
+    if (seconds <= 0.0) return;
+    struct timespec duration;
+    duration.tv_sec = (time_t)seconds;
+    duration.tv_nsec = (long)((seconds - (double)duration.tv_sec) * 1e9);
+    nanosleep(&duration, NULL);
+}
+
+static inline int ThreadHardwareConcurrency(void) {
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    return count > 0 ? (int)count : 1;
+}
+#endif
+
+#endif
@@ -0,0 +1,26 @@
+#ifndef PINBALL_TIMER_H
+#define PINBALL_TIMER_H
+
+#if defined(_WIN32)
+// Declared by hand so this header can sit next to raylib.h without pulling in windows.h.
+__declspec(dllimport) int __stdcall QueryPerformanceCounter(long long *count);
+__declspec(dllimport) int __stdcall QueryPerformanceFrequency(long long *frequency);
+
+static inline double TimerNowSeconds(void) {
+    static long long frequency = 0;
+    long long counter;
+    if (frequency == 0) QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&counter);
+    return (double)counter / (double)frequency;
+}
+#else
+#include <time.h>
+
+static inline double TimerNowSeconds(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec + (double)now.tv_nsec * 1e-9;
+}
+#endif
+
+#endif
@@ -0,0 +1,260 @@
+#include "physics.h"
+#include "policy.h"
+#include "pool.h"
+#include "table.h"
+#include "timer.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(PINBALL_PHYSICS_FIXED)
+#error "the tuner varies table physics and needs the tunable physics build"
+#endif
+
+// Monte Carlo sweep over table parameters. Every grid point plays a batch of
+// seeded single-ball games with a scripted policy until the ball drains or the
+// time limit runs out; games are split into tasks and run on a work-stealing
+// pool across all cores.
+
+#define TUNER_MAX_TABLES 16
+#define TUNER_GAMES_PER_TASK 8
+
+typedef struct {
+    float minimum;
+    float maximum;
+    int count;
+} ParameterRange;
+
+typedef enum {
+    POLICY_REACTIVE,
+    POLICY_RANDOM
+} PolicyKind;
+
+typedef struct {
+    Table *tables;
+    int pointCount;
+    int gamesPerPoint;
+    long long maxSteps;
+    PolicyKind policy;
+    GameState *states;
+    int *scores;
+    long long *lifeSteps;
+    unsigned char *drained;
+} TunerContext;
+
+static bool ParseRange(const char *text, ParameterRange *range) {
+    if (sscanf(text, "%f:%f:%d", &range->minimum, &range->maximum, &range->count) == 3 && range->count > 0) return true;
+    if (sscanf(text, "%f", &range->minimum) == 1) {
+        range->maximum = range->minimum;
+        range->count = 1;
+        return true;
+    }
+    return false;
+}
+
+static float RangeValue(const ParameterRange *range, int index) {
+    if (range->count <= 1) return range->minimum;
+    return range->minimum + (range->maximum - range->minimum) * (float)index / (float)(range->count - 1);
+}
+
+static int CompareInts(const void *a, const void *b) {
+    int left = *(const int *)a, right = *(const int *)b;
+    return (left > right) - (left < right);
+}
+
+// Plays one game. It ends when the last ball drains (the step resets the
+// score at that point, so the score is taken just before) or at maxSteps.
+static void PlayGame(const Table *table, GameState *state, PolicyKind policy, uint32_t seed, long long maxSteps,
+                     int *score, long long *lifeSteps, bool *drained) {
+    ResetGameState(table, state);
+    float jitterX = ((float)NextPolicyRandom(&seed) / 16777216.0f - 0.5f) * 40.0f;
+    float jitterVelocity = ((float)NextPolicyRandom(&seed) / 16777216.0f - 0.5f) * 200.0f;
+    state->balls.x[0] += jitterX;
+    state->balls.velocityX[0] = jitterVelocity;
+    float reachMargin = 15.0f + (float)NextPolicyRandom(&seed) / 16777216.0f * 30.0f;
+
+    unsigned int inputMask = 0;
+    *drained = false;
+    for (long long step = 0; step < maxSteps; step++) {
+        inputMask = policy == POLICY_REACTIVE ? ReactiveFlipperInput(table, state, reachMargin)
+                                              : RandomFlipperInput(inputMask, 0.02f, &seed);
+        bool lastBall = state->balls.count == 1;
+        int scoreBefore = state->score;
+        if ((StepPhysics(table, state, inputMask) & STEP_EVENT_DRAIN) && lastBall) {
+            *score = scoreBefore;
+            *lifeSteps = step + 1;
+            *drained = true;
+            return;
+        }
+    }
+    *score = state->score;
+    *lifeSteps = maxSteps;
+}
+
+static void RunTunerTask(void *context, int taskIndex, int workerIndex) {
+    TunerContext *tuner = (TunerContext *)context;
+    int tasksPerPoint = (tuner->gamesPerPoint + TUNER_GAMES_PER_TASK - 1) / TUNER_GAMES_PER_TASK;
+    int point = taskIndex / tasksPerPoint;
+    int firstGame = (taskIndex % tasksPerPoint) * TUNER_GAMES_PER_TASK;
+    int lastGame = firstGame + TUNER_GAMES_PER_TASK;
+    if (lastGame > tuner->gamesPerPoint) lastGame = tuner->gamesPerPoint;
+
+    for (int game = firstGame; game < lastGame; game++) {
+        // The seed only depends on the game number, so every point plays the same games.
+        int slot = point * tuner->gamesPerPoint + game;
+        bool drained;
+        PlayGame(&tuner->tables[point], &tuner->states[workerIndex], tuner->policy, 2654435761u * (uint32_t)(game + 1),
+                 tuner->maxSteps, &tuner->scores[slot], &tuner->lifeSteps[slot], &drained);
+        tuner->drained[slot] = drained;
+    }
+}
+
+int main(int argc, char **argv) {
+    const char *tablePaths[TUNER_MAX_TABLES];
+    int tableCount = 0;
+    ParameterRange wall = {-1.0f, -1.0f, 1}, planet = {-1.0f, -1.0f, 1}, impulse = {-1.0f, -1.0f, 1};
+    int gamesPerPoint = 200;
+    float maxSeconds = 60.0f;
+    int threadCount = 0;
+    PolicyKind policy = POLICY_REACTIVE;
+    const char *csvPath = NULL;
+    bool parsed = true;
+
+    for (int i = 1; i < argc && parsed; i++) {
+        bool hasValue = i + 1 < argc;
+        if (strcmp(argv[i], "--table") == 0 && hasValue && tableCount < TUNER_MAX_TABLES) tablePaths[tableCount++] = argv[++i];
+        else if (strcmp(argv[i], "--wall") == 0 && hasValue) parsed = ParseRange(argv[++i], &wall);
+        else if (strcmp(argv[i], "--planet") == 0 && hasValue) parsed = ParseRange(argv[++i], &planet);
+        else if (strcmp(argv[i], "--impulse") == 0 && hasValue) parsed = ParseRange(argv[++i], &impulse);
+        else if (strcmp(argv[i], "--games") == 0 && hasValue) gamesPerPoint = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--seconds") == 0 && hasValue) maxSeconds = (float)atof(argv[++i]);
+        else if (strcmp(argv[i], "--threads") == 0 && hasValue) threadCount = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--policy") == 0 && hasValue) {
+            const char *name = argv[++i];
+            if (strcmp(name, "reactive") == 0) policy = POLICY_REACTIVE;
+            else if (strcmp(name, "random") == 0) policy = POLICY_RANDOM;
+            else parsed = false;
+        }
+        else if (strcmp(argv[i], "--csv") == 0 && hasValue) csvPath = argv[++i];
+        else parsed = false;
+    }
+    if (!parsed || gamesPerPoint <= 0 || maxSeconds <= 0.0f) {
+        fprintf(stderr, "usage: %s [--table FILE]... [--wall MIN:MAX:N] [--planet MIN:MAX:N] [--impulse MIN:MAX:N]\n"
+                        "       [--games N] [--seconds S] [--policy reactive|random] [--threads N] [--csv FILE]\n", argv[0]);
+        return 1;
+    }
+
+    static Table baseTables[TUNER_MAX_TABLES];
+    if (tableCount == 0) {
+        InitDefaultTable(&baseTables[0]);
+        tablePaths[0] = "built-in";
+        tableCount = 1;
+    } else {
+        for (int i = 0; i < tableCount; i++) {
+            TableFile tableFile;
+            char error[256];
+            if (!OpenTable(tablePaths[i], &tableFile, error, sizeof(error))) {
+                fprintf(stderr, "%s\n", error);
+                return 1;
+            }
+            baseTables[i] = *tableFile.table;
+            CloseTableFile(&tableFile);
+        }
+    }
+
+    // Unset ranges keep each table's own value.
+    int pointCount = tableCount * wall.count * planet.count * impulse.count;
+    TunerContext tuner = {0};
+    tuner.pointCount = pointCount;
+    tuner.gamesPerPoint = gamesPerPoint;
+    tuner.policy = policy;
+    tuner.tables = (Table *)malloc((size_t)pointCount * sizeof(Table));
+    tuner.scores = (int *)malloc((size_t)pointCount * gamesPerPoint * sizeof(int));
+    tuner.lifeSteps = (long long *)malloc((size_t)pointCount * gamesPerPoint * sizeof(long long));
+    tuner.drained = (unsigned char *)malloc((size_t)pointCount * gamesPerPoint);
+    if (!tuner.tables || !tuner.scores || !tuner.lifeSteps || !tuner.drained) {
+        fprintf(stderr, "out of memory for %d points\n", pointCount);
+        return 1;
+    }
+
+    int point = 0;
+    for (int t = 0; t < tableCount; t++) {
+        for (int w = 0; w < wall.count; w++) {
+            for (int p = 0; p < planet.count; p++) {
+                for (int k = 0; k < impulse.count; k++) {
+                    Table *table = &tuner.tables[point++];
+                    *table = baseTables[t];
+                    if (wall.minimum >= 0.0f) table->physics.wallBounceFactor = RangeValue(&wall, w);
+                    if (planet.minimum >= 0.0f) table->physics.planetBounceFactor = RangeValue(&planet, p);
+                    if (impulse.minimum >= 0.0f) table->physics.flipperImpulseStrength = RangeValue(&impulse, k);
+                }
+            }
+        }
+    }
+
+    const float stepSeconds = tuner.tables[0].physics.fixedDeltaTime;
+    tuner.maxSteps = (long long)(maxSeconds / stepSeconds);
+
+    static TaskPool pool;
+    InitTaskPool(&pool, threadCount);
+    tuner.states = (GameState *)calloc((size_t)pool.workerCount, sizeof(GameState));
+    for (int i = 0; i < pool.workerCount; i++) {
+        if (!tuner.states || !InitGameState(&tuner.tables[0], &tuner.states[i], 1 + MULTIBALL_EXTRA_BALLS)) {
+            fprintf(stderr, "out of memory\n");
+            return 1;
+        }
+    }
+
+    int tasksPerPoint = (gamesPerPoint + TUNER_GAMES_PER_TASK - 1) / TUNER_GAMES_PER_TASK;
+    double startTime = TimerNowSeconds();
+    RunTaskPool(&pool, pointCount * tasksPerPoint, RunTunerTask, &tuner);
+    double elapsed = TimerNowSeconds() - startTime;
+
+    FILE *csv = csvPath ? fopen(csvPath, "w") : NULL;
+    if (csvPath && !csv) fprintf(stderr, "cannot write %s\n", csvPath);
+    if (csv) fprintf(csv, "table,wall_bounce,planet_bounce,flipper_impulse,games,drained,drains_per_min,mean_life_s,score_p10,score_p50,score_p90,score_max\n");
+
+    printf("%-12s %6s %6s %8s  %7s %9s %9s  %8s %8s %8s %8s\n",
+           "table", "wall", "planet", "impulse", "drained", "drain/min", "life s", "p10", "p50", "p90", "max");
+    long long totalSteps = 0;
+    for (point = 0; point < pointCount; point++) {
+        const Table *table = &tuner.tables[point];
+        int *scores = &tuner.scores[point * gamesPerPoint];
+        long long lifeSteps = 0;
+        int drainedGames = 0;
+        for (int game = 0; game < gamesPerPoint; game++) {
+            lifeSteps += tuner.lifeSteps[point * gamesPerPoint + game];
+            drainedGames += tuner.drained[point * gamesPerPoint + game];
+        }
+        totalSteps += lifeSteps;
+        qsort(scores, (size_t)gamesPerPoint, sizeof(int), CompareInts);
+
+        double simulatedMinutes = lifeSteps * (double)table->physics.fixedDeltaTime / 60.0;
+        double meanLife = lifeSteps * (double)table->physics.fixedDeltaTime / gamesPerPoint;
+        const char *tableName = tablePaths[point / (wall.count * planet.count * impulse.count)];
+        int p10 = scores[gamesPerPoint / 10], p50 = scores[gamesPerPoint / 2];
+        int p90 = scores[(gamesPerPoint * 9) / 10], maximum = scores[gamesPerPoint - 1];
+
+        printf("%-12.12s %6.3f %6.3f %8.1f  %6.1f%% %9.2f %9.2f  %8d %8d %8d %8d\n", tableName,
+               table->physics.wallBounceFactor, table->physics.planetBounceFactor, table->physics.flipperImpulseStrength,
+               100.0 * drainedGames / gamesPerPoint, drainedGames / simulatedMinutes, meanLife, p10, p50, p90, maximum);
+        if (csv) {
+            fprintf(csv, "%s,%g,%g,%g,%d,%d,%g,%g,%d,%d,%d,%d\n", tableName,
+                    table->physics.wallBounceFactor, table->physics.planetBounceFactor, table->physics.flipperImpulseStrength,
+                    gamesPerPoint, drainedGames, drainedGames / simulatedMinutes, meanLife, p10, p50, p90, maximum);
+        }
+    }
+    if (csv) fclose(csv);
+
+    printf("%d points x %d games on %d threads: %lld steps in %.2f s (%.0f steps/sec)\n", pointCount, gamesPerPoint,
+           pool.workerCount, totalSteps, elapsed, totalSteps / (elapsed > 0.0 ? elapsed : 1e-9));
+
+    DestroyTaskPool(&pool);
+    for (int i = 0; i < pool.workerCount; i++) FreeGameState(&tuner.states[i]);
+    free(tuner.states);
+    free(tuner.tables);
+    free(tuner.scores);
+    free(tuner.lifeSteps);
+    free(tuner.drained);
+    return 0;
+}
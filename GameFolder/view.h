@@ -0,0 +1,60 @@
+#ifndef PINBALL_VIEW_H
+#define PINBALL_VIEW_H
+
+#include "raylib.h"
+#include "physics.h"
+
+// The game is drawn in table units into an offscreen target at a chosen
+// internal resolution, then scaled into the window with letterboxing. The
+// simulation never sees pixels, so a large panel can run at a lower internal
+// resolution (or a small one at a higher) without changing gameplay.
+
+typedef struct {
+    RenderTexture2D target;
+    Camera2D camera;
+    float tableWidth;
+    float tableHeight;
+    float renderScale;
+} RenderView;
+
+// renderScale is internal pixels per table unit.
+static inline void InitRenderView(RenderView *view, const Table *table, float renderScale) {
+    view->tableWidth = table->width;
+    view->tableHeight = table->height;
+    view->renderScale = renderScale;
+    view->target = LoadRenderTexture((int)ceilf(table->width * renderScale), (int)ceilf(table->height * renderScale));
+    SetTextureFilter(view->target.texture, TEXTURE_FILTER_BILINEAR);
+    view->camera = (Camera2D){{0, 0}, {0, 0}, 0.0f, renderScale};
+}
+
+static inline void UnloadRenderView(RenderView *view) {
+    if (view->target.id != 0) UnloadRenderTexture(view->target);
+    view->target = (RenderTexture2D){0};
+}
+
+static inline void BeginRenderView(const RenderView *view) {
+    BeginTextureMode(view->target);
+    BeginMode2D(view->camera);
+}
+
+static inline void EndRenderView(void) {
+    EndMode2D();
+    EndTextureMode();
+}
+
+// Largest rectangle of the table's aspect that fits the window, centred.
+static inline Rectangle RenderViewDestination(const RenderView *view, int screenWidth, int screenHeight) {
+    float scale = fminf(screenWidth / view->tableWidth, screenHeight / view->tableHeight);
+    float width = view->tableWidth * scale, height = view->tableHeight * scale;
+    return (Rectangle){(screenWidth - width) * 0.5f, (screenHeight - height) * 0.5f, width, height};
+}
+
+// Call between BeginDrawing and EndDrawing. The bars outside the playfield
+// are left to the caller's clear colour.
+static inline void PresentRenderView(const RenderView *view, int screenWidth, int screenHeight) {
+    Rectangle source = {0, 0, (float)view->target.texture.width, -(float)view->target.texture.height};
+    DrawTexturePro(view->target.texture, source, RenderViewDestination(view, screenWidth, screenHeight),
+                   (Vector2){0, 0}, 0.0f, WHITE);
+}
+
+#endif